@@ -87,12 +87,16 @@ LOCAL_SRC_FILES := \
   src/components/river.cpp \
   src/components/scenery.cpp \
   src/components/services.cpp \
+  src/components/shadow_caster.cpp \
   src/components/shadow_controller.cpp \
   src/components/simple_movement.cpp \
+  src/components/sorted_mesh.cpp \
   src/components/sound.cpp \
   src/components/time_limit.cpp \
   src/default_entity_factory.cpp \
   src/default_graph_factory.cpp \
+  src/frame_pacer.cpp \
+  src/frustum.cpp \
   src/full_screen_fader.cpp \
   src/game.cpp \
   src/gpg_manager.cpp \
@@ -100,6 +104,7 @@ LOCAL_SRC_FILES := \
   src/inputcontrollers/android_cardboard_controller.cpp \
   src/inputcontrollers/gamepad_controller.cpp \
   src/inputcontrollers/onscreen_controller.cpp \
+  src/job_system.cpp \
   src/main.cpp \
   src/modules/attributes.cpp \
   src/modules/gpg.cpp \
@@ -108,7 +113,10 @@ LOCAL_SRC_FILES := \
   src/modules/rail_denizen.cpp \
   src/modules/state.cpp \
   src/modules/zooshi.cpp \
+  src/profiler.cpp \
+  src/quality_governor.cpp \
   src/railmanager.cpp \
+  src/spatial_grid.cpp \
   src/states/game_menu_state.cpp \
   src/states/game_over_state.cpp \
   src/states/gameplay_state.cpp \
@@ -117,6 +125,8 @@ LOCAL_SRC_FILES := \
   src/states/pause_state.cpp \
   src/states/states_common.cpp \
   src/states/scene_lab_state.cpp \
+  src/trace.cpp \
+  src/transform_interpolator.cpp \
   src/world.cpp \
   src/world_renderer.cpp \
   $(DEPENDENCIES_FLATBUFFERS_DIR)/src/idl_parser.cpp \
@@ -14,6 +14,7 @@
 
 #include "components/lap_dependent.h"
 
+#include <algorithm>
 #include "components/rail_denizen.h"
 #include "components/services.h"
 #include "corgi_component_library/physics.h"
@@ -46,6 +47,7 @@ void LapDependentComponent::AddFromRawData(corgi::EntityRef& entity,
   LapDependentData* lap_dependent_data = AddEntity(entity);
   lap_dependent_data->min_lap = lap_dependent_def->min_lap();
   lap_dependent_data->max_lap = lap_dependent_def->max_lap();
+  schedule_dirty_ = true;
 }
 
 corgi::ComponentInterface::RawDataUniquePtr
@@ -64,6 +66,10 @@ LapDependentComponent::ExportRawData(const corgi::EntityRef& entity) const {
 
 void LapDependentComponent::InitEntity(corgi::EntityRef& /*entity*/) {}
 
+void LapDependentComponent::CleanupEntity(corgi::EntityRef& /*entity*/) {
+  schedule_dirty_ = true;
+}
+
 void LapDependentComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
   corgi::EntityRef raft =
       entity_manager_->GetComponent<ServicesComponent>()->raft_entity();
@@ -72,32 +78,113 @@ void LapDependentComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
   float lap = raft_rail_denizen != nullptr
                   ? raft_rail_denizen->total_lap_progress
                   : 0.0f;
+
+  // The lap only goes backwards when the raft is reset, so the schedule can
+  // normally be advanced from where it was last frame.
+  if (schedule_dirty_ || lap < scheduled_lap_) {
+    RebuildSchedule(lap);
+  } else if (lap > scheduled_lap_) {
+    AdvanceSchedule(lap);
+  }
+  ApplyActivations();
+}
+
+// Sort the entities by the laps at which they activate and deactivate, and
+// bring every entity in line with `lap`.
+void LapDependentComponent::RebuildSchedule(float lap) {
+  activation_schedule_.clear();
+  deactivation_schedule_.clear();
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
-    LapDependentData* data = GetComponentData(iter->entity);
-    if (lap >= data->min_lap && lap <= data->max_lap) {
-      if (data->currently_active) continue;
-      data->currently_active = true;
-      auto rm_component = entity_manager_->GetComponent<RenderMeshComponent>();
-      if (rm_component) {
-        rm_component->SetVisibilityRecursively(iter->entity, true);
-      }
-      auto phys_component = entity_manager_->GetComponent<PhysicsComponent>();
-      if (phys_component) {
-        phys_component->EnablePhysics(iter->entity);
-      }
-    } else if (data->currently_active) {
-      data->currently_active = false;
-      auto rm_component = entity_manager_->GetComponent<RenderMeshComponent>();
-      if (rm_component) {
-        rm_component->SetVisibilityRecursively(iter->entity, false);
-      }
-      auto phys_component = entity_manager_->GetComponent<PhysicsComponent>();
-      if (phys_component) {
-        phys_component->DisablePhysics(iter->entity);
-      }
+    LapDependentData* data = &iter->data;
+    ScheduleEntry entry;
+    entry.entity = iter->entity;
+    entry.lap = data->min_lap;
+    activation_schedule_.push_back(entry);
+    entry.lap = data->max_lap;
+    deactivation_schedule_.push_back(entry);
+
+    const bool active = lap >= data->min_lap && lap <= data->max_lap;
+    if (active && !data->currently_active) {
+      to_activate_.push_back(iter->entity);
+    } else if (!active && data->currently_active) {
+      to_deactivate_.push_back(iter->entity);
+    }
+  }
+  std::sort(activation_schedule_.begin(), activation_schedule_.end());
+  std::sort(deactivation_schedule_.begin(), deactivation_schedule_.end());
+
+  ScheduleEntry key;
+  key.lap = lap;
+  activation_cursor_ = static_cast<size_t>(
+      std::upper_bound(activation_schedule_.begin(),
+                       activation_schedule_.end(), key) -
+      activation_schedule_.begin());
+  deactivation_cursor_ = static_cast<size_t>(
+      std::lower_bound(deactivation_schedule_.begin(),
+                       deactivation_schedule_.end(), key) -
+      deactivation_schedule_.begin());
+  scheduled_lap_ = lap;
+  schedule_dirty_ = false;
+}
+
+// Move the cursors up to `lap`, which must be greater than `scheduled_lap_`.
+// Only the entities whose window opened or closed in between are visited.
+void LapDependentComponent::AdvanceSchedule(float lap) {
+  for (; activation_cursor_ < activation_schedule_.size() &&
+         activation_schedule_[activation_cursor_].lap <= lap;
+       ++activation_cursor_) {
+    const corgi::EntityRef& entity =
+        activation_schedule_[activation_cursor_].entity;
+    const LapDependentData* data = GetComponentData(entity);
+    if (!data->currently_active && lap <= data->max_lap) {
+      to_activate_.push_back(entity);
+    }
+  }
+  for (; deactivation_cursor_ < deactivation_schedule_.size() &&
+         deactivation_schedule_[deactivation_cursor_].lap < lap;
+       ++deactivation_cursor_) {
+    const corgi::EntityRef& entity =
+        deactivation_schedule_[deactivation_cursor_].entity;
+    const LapDependentData* data = GetComponentData(entity);
+    if (data->currently_active) {
+      to_deactivate_.push_back(entity);
+    }
+  }
+  scheduled_lap_ = lap;
+}
+
+// Show and enable the physics of the entities in `to_activate_`, and hide and
+// disable the ones in `to_deactivate_`.
+void LapDependentComponent::ApplyActivations() {
+  if (to_activate_.empty() && to_deactivate_.empty()) return;
+
+  for (auto it = to_activate_.begin(); it != to_activate_.end(); ++it) {
+    GetComponentData(*it)->currently_active = true;
+  }
+  for (auto it = to_deactivate_.begin(); it != to_deactivate_.end(); ++it) {
+    GetComponentData(*it)->currently_active = false;
+  }
+  auto rm_component = entity_manager_->GetComponent<RenderMeshComponent>();
+  if (rm_component) {
+    for (auto it = to_activate_.begin(); it != to_activate_.end(); ++it) {
+      rm_component->SetVisibilityRecursively(*it, true);
+    }
+    for (auto it = to_deactivate_.begin(); it != to_deactivate_.end(); ++it) {
+      rm_component->SetVisibilityRecursively(*it, false);
+    }
+  }
+  auto phys_component = entity_manager_->GetComponent<PhysicsComponent>();
+  if (phys_component) {
+    for (auto it = to_activate_.begin(); it != to_activate_.end(); ++it) {
+      phys_component->EnablePhysics(*it);
+    }
+    for (auto it = to_deactivate_.begin(); it != to_deactivate_.end(); ++it) {
+      phys_component->DisablePhysics(*it);
     }
   }
+  to_activate_.clear();
+  to_deactivate_.clear();
 }
 
 void LapDependentComponent::ActivateAllEntities() {
@@ -106,6 +193,7 @@ void LapDependentComponent::ActivateAllEntities() {
        ++iter) {
     ActivateEntity(iter->entity);
   }
+  schedule_dirty_ = true;
 }
 
 void LapDependentComponent::DeactivateAllEntities() {
@@ -114,6 +202,7 @@ void LapDependentComponent::DeactivateAllEntities() {
        ++iter) {
     DeactivateEntity(iter->entity);
   }
+  schedule_dirty_ = true;
 }
 
 void LapDependentComponent::ActivateEntity(corgi::EntityRef& entity) {
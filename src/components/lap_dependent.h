@@ -15,6 +15,7 @@
 #ifndef COMPONENTS_LAP_DEPENDENT_H_
 #define COMPONENTS_LAP_DEPENDENT_H_
 
+#include <vector>
 #include "components_generated.h"
 #include "corgi/component.h"
 #include "corgi/entity_manager.h"
@@ -32,20 +33,56 @@ struct LapDependentData {
 
 class LapDependentComponent : public corgi::Component<LapDependentData> {
  public:
+  LapDependentComponent()
+      : activation_cursor_(0),
+        deactivation_cursor_(0),
+        scheduled_lap_(0.0f),
+        schedule_dirty_(true) {}
   virtual ~LapDependentComponent() {}
 
   virtual void Init();
   virtual void AddFromRawData(corgi::EntityRef& entity, const void* raw_data);
   virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
   virtual void InitEntity(corgi::EntityRef& entity);
+  virtual void CleanupEntity(corgi::EntityRef& entity);
   virtual void UpdateAllEntities(corgi::WorldTime delta_time);
 
   void ActivateAllEntities();
   void DeactivateAllEntities();
 
  private:
+  // The lap at which an entity's window opens or closes.
+  struct ScheduleEntry {
+    float lap;
+    corgi::EntityRef entity;
+    bool operator<(const ScheduleEntry& rhs) const { return lap < rhs.lap; }
+  };
+
   void ActivateEntity(corgi::EntityRef& entity);
   void DeactivateEntity(corgi::EntityRef& entity);
+  void RebuildSchedule(float lap);
+  void AdvanceSchedule(float lap);
+  void ApplyActivations();
+
+  // Every entity, sorted by `min_lap`, and again sorted by `max_lap`.
+  std::vector<ScheduleEntry> activation_schedule_;
+  std::vector<ScheduleEntry> deactivation_schedule_;
+
+  // Number of entities whose `min_lap` is at most `scheduled_lap_`, and number
+  // of entities whose `max_lap` is less than `scheduled_lap_`.
+  size_t activation_cursor_;
+  size_t deactivation_cursor_;
+
+  // The lap that the schedule has been advanced to.
+  float scheduled_lap_;
+
+  // True when the schedule has to be rebuilt, because entities were added or
+  // removed, or were activated or deactivated outside of the schedule.
+  bool schedule_dirty_;
+
+  // The entities whose activation changes this frame.
+  std::vector<corgi::EntityRef> to_activate_;
+  std::vector<corgi::EntityRef> to_deactivate_;
 };
 
 }  // zooshi
@@ -14,6 +14,7 @@
 
 #include "components/patron.h"
 
+#include <algorithm>
 #include <vector>
 #include "components/attributes.h"
 #include "components/player.h"
@@ -99,6 +100,11 @@ void PatronComponent::Init() {
   if (scene_lab) {
     scene_lab->AddOnEnterEditorCallback([this]() { UpdateAndEnablePhysics(); });
     scene_lab->AddOnExitEditorCallback([this]() { PostLoadFixup(); });
+    // Patrons moved in Scene Lab need their hot state refreshed.
+    scene_lab->AddOnUpdateEntityCallback(
+        [this](const corgi::EntityRef& entity) {
+          if (GetComponentData(entity) != nullptr) hot_state_dirty_ = true;
+        });
   }
 }
 
@@ -114,6 +120,7 @@ void PatronComponent::AddFromRawData(corgi::EntityRef& entity,
   auto patron_def = static_cast<const PatronDef*>(raw_data);
   PatronData* patron_data = AddEntity(entity);
   patron_data->anim_object = patron_def->anim_object();
+  hot_state_dirty_ = true;
 
   patron_data->pop_in_radius = LoadInterpolants(patron_def->pop_in_radius());
   patron_data->pop_out_radius = patron_def->pop_out_radius();
@@ -226,6 +233,11 @@ corgi::ComponentInterface::RawDataUniquePtr PatronComponent::ExportRawData(
 
 void PatronComponent::InitEntity(corgi::EntityRef& entity) { (void)entity; }
 
+void PatronComponent::CleanupEntity(corgi::EntityRef& entity) {
+  (void)entity;
+  hot_state_dirty_ = true;
+}
+
 void PatronComponent::UpdateAndEnablePhysics() {
   // Make the patrons stand up
   RenderMeshComponent* render_mesh_component =
@@ -239,6 +251,7 @@ void PatronComponent::UpdateAndEnablePhysics() {
 
     render_mesh_component->SetVisibilityRecursively(patron, true);
   }
+  hot_state_dirty_ = true;
 }
 
 void PatronComponent::PostLoadFixup() {
@@ -247,6 +260,7 @@ void PatronComponent::PostLoadFixup() {
 
   // Initialize each patron.
   auto physics_component = entity_manager_->GetComponent<PhysicsComponent>();
+  max_catch_time_for_search_ = 0.0f;
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
     corgi::EntityRef patron = iter->entity;
@@ -274,6 +288,11 @@ void PatronComponent::PostLoadFixup() {
         physics_data->RigidBodyIndex(patron_data->target_tag);
     patron_data->target_rigid_body_index = target_index < 0 ? 0 : target_index;
 
+    // Projectiles are indexed along the longest trajectory any patron will
+    // search.
+    max_catch_time_for_search_ = std::max(
+        max_catch_time_for_search_, patron_data->catch_time_for_search.end());
+
     // Patrons that are done should not have physics enabled.
     physics_component->DisablePhysics(patron);
     // We don't want patrons moving until they are up.
@@ -283,6 +302,7 @@ void PatronComponent::PostLoadFixup() {
       rail_denizen_data->SetSplinePlaybackRate(0.0f);
     }
   }
+  hot_state_dirty_ = true;
 }
 
 // Return time until the patron's patience has expired.
@@ -448,139 +468,289 @@ bool PatronComponent::ShouldDisappear(
   return time_until_exasperated <= 0.0f;
 }
 
+// Mirror the hot fields of every patron into `hot_state_`. Every patron starts
+// out awake, so the next update runs each of them through the full state
+// machine once, which re-establishes their visibility.
+void PatronComponent::SyncHotState() {
+  hot_state_.entities.clear();
+  for (auto iter = component_data_.begin(); iter != component_data_.end();
+       ++iter) {
+    hot_state_.entities.push_back(iter->entity);
+  }
+  hot_state_.Resize(hot_state_.entities.size());
+  for (size_t i = 0; i < hot_state_.entities.size(); ++i) {
+    RefreshHotState(i, false);
+    hot_state_.pending_seconds[i] = 0.0f;
+  }
+  hot_state_dirty_ = false;
+}
+
+// Copy the hot fields of patron `i` from its component data. A patron is
+// asleep if it is laying down, already hidden, and has nothing in motion.
+// Asleep patrons are skipped until they need to stand up.
+void PatronComponent::RefreshHotState(size_t i, bool hidden) {
+  const corgi::EntityRef& patron = hot_state_.entities[i];
+  const PatronData* patron_data = Data<PatronData>(patron);
+  const TransformData* transform_data = Data<TransformData>(patron);
+  hot_state_.asleep[i] = static_cast<uint8_t>(
+      hidden && patron_data->state == kPatronStateLayingDown &&
+      patron_data->move_state == kPatronMoveStateIdle &&
+      !patron_data->delta_position.Valid() &&
+      !patron_data->delta_face_angle.Valid() && patron_data->events.empty());
+  hot_state_.position_x[i] = transform_data->position.x();
+  hot_state_.position_y[i] = transform_data->position.y();
+  hot_state_.position_z[i] = transform_data->position.z();
+  hot_state_.last_lap_upright[i] = patron_data->last_lap_upright;
+  hot_state_.min_lap[i] = patron_data->min_lap;
+  hot_state_.max_lap[i] = patron_data->max_lap;
+  hot_state_.pop_in_value_start[i] = patron_data->pop_in_radius.values.start();
+  hot_state_.pop_in_value_end[i] = patron_data->pop_in_radius.values.end();
+  hot_state_.pop_in_time_start[i] = patron_data->pop_in_radius.times.start();
+  hot_state_.pop_in_time_end[i] = patron_data->pop_in_radius.times.end();
+}
+
+// Linear scan over the hot state that selects the patrons that have to run
+// through the state machine this frame: the awake ones, plus the asleep ones
+// that are about to stand up. The stand-up test mirrors ShouldAppear(), but
+// runs over packed arrays without branches, so it stays cheap when hundreds of
+// patrons are laying down. Skipped patrons accumulate the elapsed time, which
+// is added onto their timers when they wake up.
+void PatronComponent::FindAwakePatrons(const vec3& raft_position, float lap,
+                                       float delta_seconds) {
+  const size_t num_patrons = hot_state_.entities.size();
+  const uint8_t* asleep = hot_state_.asleep.data();
+  const float* position_x = hot_state_.position_x.data();
+  const float* position_y = hot_state_.position_y.data();
+  const float* position_z = hot_state_.position_z.data();
+  const float* last_lap_upright = hot_state_.last_lap_upright.data();
+  const float* min_lap = hot_state_.min_lap.data();
+  const float* max_lap = hot_state_.max_lap.data();
+  const float* value_start = hot_state_.pop_in_value_start.data();
+  const float* value_end = hot_state_.pop_in_value_end.data();
+  const float* time_start = hot_state_.pop_in_time_start.data();
+  const float* time_end = hot_state_.pop_in_time_end.data();
+  uint8_t* awake = hot_state_.awake.data();
+  float* pending_seconds = hot_state_.pending_seconds.data();
+  const float raft_x = raft_position.x();
+  const float raft_y = raft_position.y();
+  const float raft_z = raft_position.z();
+
+  for (size_t i = 0; i < num_patrons; ++i) {
+    const float dx = position_x[i] - raft_x;
+    const float dy = position_y[i] - raft_y;
+    const float dz = position_z[i] - raft_z;
+    const float dist_sq = dx * dx + dy * dy + dz * dz;
+
+    // Same as Interpolate(pop_in_radius, lap).
+    const float time_length = time_end[i] - time_start[i];
+    const float time_offset = lap - time_start[i];
+    const float percent_unclamped =
+        time_length > 0.0f ? time_offset / time_length
+                           : (time_offset > 0.0f ? 1.0f : 0.0f);
+    const float percent = std::min(std::max(percent_unclamped, 0.0f), 1.0f);
+    const float radius =
+        value_start[i] + (value_end[i] - value_start[i]) * percent;
+
+    const bool appear = (lap >= last_lap_upright[i] + kLapWaitAmount) &
+                        (lap >= min_lap[i]) &
+                        ((lap <= max_lap[i]) | (max_lap[i] < 0.0f)) &
+                        (radius >= 0.0f) & (dist_sq <= radius * radius);
+    awake[i] = static_cast<uint8_t>(!asleep[i] | appear);
+    pending_seconds[i] += awake[i] ? 0.0f : delta_seconds;
+  }
+
+  awake_patrons_.clear();
+  for (size_t i = 0; i < num_patrons; ++i) {
+    if (awake[i]) awake_patrons_.push_back(i);
+  }
+}
+
 void PatronComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
   corgi::EntityRef raft =
       entity_manager_->GetComponent<ServicesComponent>()->raft_entity();
   if (!raft) return;
   const RailDenizenData* raft_rail_denizen = Data<RailDenizenData>(raft);
-  for (auto iter = component_data_.begin(); iter != component_data_.end();
-       ++iter) {
-    corgi::EntityRef patron = iter->entity;
-    TransformData* transform_data = Data<TransformData>(patron);
+  UpdateProjectileGrid();
+  if (hot_state_dirty_) {
+    SyncHotState();
+  }
+
+  const float delta_seconds =
+      static_cast<float>(delta_time) / corgi::kMillisecondsPerSecond;
+  FindAwakePatrons(raft_rail_denizen->Position(),
+                   raft_rail_denizen->total_lap_progress, delta_seconds);
+
+  for (auto it = awake_patrons_.begin(); it != awake_patrons_.end(); ++it) {
+    const size_t i = *it;
+    const corgi::EntityRef& patron = hot_state_.entities[i];
+    if (!patron.IsValid()) continue;
+
+    // Catch up on the time spent asleep. Asleep patrons are always idle, so
+    // they were being ignored for all of it.
     PatronData* patron_data = Data<PatronData>(patron);
-    RenderMeshComponent* rm_component =
-        entity_manager_->GetComponent<RenderMeshComponent>();
-    PhysicsComponent* physics_component =
-        entity_manager_->GetComponent<PhysicsComponent>();
-
-    // Animate patrons in the event.
-    const int num_events = static_cast<int>(patron_data->events.size());
-    if (event_time_ >= 0 && num_events > 0) {
-      const bool anim_ending = AnimationEnding(patron_data, delta_time);
-      if (patron_data->event_index < num_events) {
-        const PatronEvent& event =
-            patron_data->events[patron_data->event_index];
-        if ((event.time >= 0 && event.time <= event_time_) ||
-            (event.time < 0 && anim_ending)) {
-          // Start new animation.
-          Animate(patron_data, event.action);
-          patron_data->event_index++;
-          SetState(kPatronStateInEvent, patron_data);
-        }
-      } else if (anim_ending) {
-        // Disable event patron since we've played the last event.
-        SetState(kPatronStateLayingDown, patron_data);
-      }
+    if (hot_state_.pending_seconds[i] > 0.0f) {
+      const float pending_seconds = hot_state_.pending_seconds[i];
+      patron_data->time_in_move_state += pending_seconds;
+      patron_data->time_in_state += pending_seconds;
+      patron_data->time_being_ignored += pending_seconds;
+      hot_state_.pending_seconds[i] = 0.0f;
     }
 
-    const PatronState state = patron_data->state;
-    rm_component->SetVisibilityRecursively(patron,
-                                           state != kPatronStateLayingDown);
-    if (num_events > 0) continue;
+    // UpdatePatron() sets the visibility from the state it starts in.
+    const bool hidden = patron_data->state == kPatronStateLayingDown;
+    UpdatePatron(patron, delta_time, raft_rail_denizen);
+    RefreshHotState(i, hidden);
+  }
+  KeepAsleepPatronsHidden();
+  if (event_time_ >= 0) {
+    event_time_ += delta_time;
+  }
+}
 
-    // Remember the last idle position so we can return to later.
-    if (patron_data->move_state == kPatronMoveStateIdle) {
-      patron_data->return_position = transform_data->position;
-    }
+// Asleep patrons skip UpdatePatron(), so keep hiding them every frame in case
+// something else showed them. Their positions are refreshed at the same time,
+// in case they were moved while asleep.
+void PatronComponent::KeepAsleepPatronsHidden() {
+  RenderMeshComponent* rm_component =
+      entity_manager_->GetComponent<RenderMeshComponent>();
+  const uint8_t* awake = hot_state_.awake.data();
+  for (size_t i = 0; i < hot_state_.entities.size(); ++i) {
+    if (awake[i]) continue;
+    corgi::EntityRef& patron = hot_state_.entities[i];
+    if (!patron.IsValid()) continue;
+    rm_component->SetVisibilityRecursively(patron, false);
+    const TransformData* transform_data = Data<TransformData>(patron);
+    hot_state_.position_x[i] = transform_data->position.x();
+    hot_state_.position_y[i] = transform_data->position.y();
+    hot_state_.position_z[i] = transform_data->position.z();
+  }
+}
 
-    // Move patron towards the target.
-    UpdateMovement(patron);
+// Run one patron through its state machine.
+void PatronComponent::UpdatePatron(const corgi::EntityRef& patron,
+                                   corgi::WorldTime delta_time,
+                                   const RailDenizenData* raft_rail_denizen) {
+  RenderMeshComponent* rm_component =
+      entity_manager_->GetComponent<RenderMeshComponent>();
+  PhysicsComponent* physics_component =
+      entity_manager_->GetComponent<PhysicsComponent>();
+  TransformData* transform_data = Data<TransformData>(patron);
+  PatronData* patron_data = Data<PatronData>(patron);
 
-    // Set the patron's movement target.
-    if (state == kPatronStateUpright &&
-        (patron_data->move_state != kPatronMoveStateMoveToTarget ||
-         patron_data->time_in_move_state >
-             patron_data->time_between_catch_searches)) {
-      FindProjectileAndCatch(patron);
-    }
-    if ((state == kPatronStateUpright || state == kPatronStateGettingUp) &&
-        patron_data->move_state == kPatronMoveStateIdle) {
-      FaceRaft(patron);
+  // Animate patrons in the event.
+  const int num_events = static_cast<int>(patron_data->events.size());
+  if (event_time_ >= 0 && num_events > 0) {
+    const bool anim_ending = AnimationEnding(patron_data, delta_time);
+    if (patron_data->event_index < num_events) {
+      const PatronEvent& event =
+          patron_data->events[patron_data->event_index];
+      if ((event.time >= 0 && event.time <= event_time_) ||
+          (event.time < 0 && anim_ending)) {
+        // Start new animation.
+        Animate(patron_data, event.action);
+        patron_data->event_index++;
+        SetState(kPatronStateInEvent, patron_data);
+      }
+    } else if (anim_ending) {
+      // Disable event patron since we've played the last event.
+      SetState(kPatronStateLayingDown, patron_data);
     }
+  }
 
-    if (ShouldAppear(patron_data, transform_data, raft_rail_denizen)) {
-      SetState(kPatronStateGettingUp, patron_data);
-      Animate(patron_data, PatronAction_GetUp);
-      patron_data->last_lap_upright = raft_rail_denizen->total_lap_progress;
+  const PatronState state = patron_data->state;
+  rm_component->SetVisibilityRecursively(patron,
+                                         state != kPatronStateLayingDown);
+  if (num_events > 0) return;
 
-    } else if (ShouldDisappear(patron_data, transform_data,
-                               raft_rail_denizen)) {
-      SetState(kPatronStateFalling, patron_data);
-      Animate(patron_data, PatronAction_Fall);
+  // Remember the last idle position so we can return to later.
+  if (patron_data->move_state == kPatronMoveStateIdle) {
+    patron_data->return_position = transform_data->position;
+  }
 
-      entity_manager_->GetComponent<PhysicsComponent>()->DisablePhysics(patron);
-      auto rail_denizen_data = Data<RailDenizenData>(patron);
-      if (rail_denizen_data != nullptr) {
-        rail_denizen_data->enabled = false;
-        rail_denizen_data->SetSplinePlaybackRate(0.0f);
-      }
-    }
+  // Move patron towards the target.
+  UpdateMovement(patron);
 
-    // Transition to the next state if we're at the end of the current
-    // animation.
-    const bool anim_ending = AnimationEnding(patron_data, delta_time);
-    if (anim_ending) {
-      switch (patron_data->state) {
-        case kPatronStateEating:
-          SetState(kPatronStateSatisfied, patron_data);
-          Animate(patron_data, PatronAction_Satisfied);
-          break;
-
-        case kPatronStateSatisfied:
-          SetState(kPatronStateFalling, patron_data);
-          Animate(patron_data, PatronAction_Fall);
-          break;
-
-        case kPatronStateFalling:
-          // After the patron has finished their falling animation, turn off
-          // the physics, as they are no longer in the world.
-          physics_component->DisablePhysics(patron);
-          SetState(kPatronStateLayingDown, patron_data);
-          break;
-
-        case kPatronStateGettingUp: {
-          SetState(kPatronStateUpright, patron_data);
-          physics_component->EnablePhysics(patron);
-          auto rail_denizen_data = Data<RailDenizenData>(patron);
-          if (rail_denizen_data != nullptr) {
-            rail_denizen_data->enabled = true;
-            rail_denizen_data->SetPlaybackRate(
-                rail_denizen_data->initial_playback_rate,
-                corgi::kMillisecondsPerSecond *
-                    patron_data->rail_accelerate_time);
-          }
-        }  // fallthrough
-
-        case kPatronStateUpright:
-          Animate(patron_data, PatronAction_Idle);
-          break;
-
-        default:
-          break;
-      }
+  // Set the patron's movement target.
+  if (state == kPatronStateUpright &&
+      (patron_data->move_state != kPatronMoveStateMoveToTarget ||
+       patron_data->time_in_move_state >
+           patron_data->time_between_catch_searches)) {
+    FindProjectileAndCatch(patron);
+  }
+  if ((state == kPatronStateUpright || state == kPatronStateGettingUp) &&
+      patron_data->move_state == kPatronMoveStateIdle) {
+    FaceRaft(patron);
+  }
+
+  if (ShouldAppear(patron_data, transform_data, raft_rail_denizen)) {
+    SetState(kPatronStateGettingUp, patron_data);
+    Animate(patron_data, PatronAction_GetUp);
+    patron_data->last_lap_upright = raft_rail_denizen->total_lap_progress;
+
+  } else if (ShouldDisappear(patron_data, transform_data,
+                             raft_rail_denizen)) {
+    SetState(kPatronStateFalling, patron_data);
+    Animate(patron_data, PatronAction_Fall);
+
+    physics_component->DisablePhysics(patron);
+    auto rail_denizen_data = Data<RailDenizenData>(patron);
+    if (rail_denizen_data != nullptr) {
+      rail_denizen_data->enabled = false;
+      rail_denizen_data->SetSplinePlaybackRate(0.0f);
     }
+  }
+
+  // Transition to the next state if we're at the end of the current
+  // animation.
+  const bool anim_ending = AnimationEnding(patron_data, delta_time);
+  if (anim_ending) {
+    switch (patron_data->state) {
+      case kPatronStateEating:
+        SetState(kPatronStateSatisfied, patron_data);
+        Animate(patron_data, PatronAction_Satisfied);
+        break;
+
+      case kPatronStateSatisfied:
+        SetState(kPatronStateFalling, patron_data);
+        Animate(patron_data, PatronAction_Fall);
+        break;
+
+      case kPatronStateFalling:
+        // After the patron has finished their falling animation, turn off
+        // the physics, as they are no longer in the world.
+        physics_component->DisablePhysics(patron);
+        SetState(kPatronStateLayingDown, patron_data);
+        break;
+
+      case kPatronStateGettingUp: {
+        SetState(kPatronStateUpright, patron_data);
+        physics_component->EnablePhysics(patron);
+        auto rail_denizen_data = Data<RailDenizenData>(patron);
+        if (rail_denizen_data != nullptr) {
+          rail_denizen_data->enabled = true;
+          rail_denizen_data->SetPlaybackRate(
+              rail_denizen_data->initial_playback_rate,
+              corgi::kMillisecondsPerSecond *
+                  patron_data->rail_accelerate_time);
+        }
+      }  // fallthrough
+
+      case kPatronStateUpright:
+        Animate(patron_data, PatronAction_Idle);
+        break;
 
-    // Update timers.
-    const float delta_seconds =
-        static_cast<float>(delta_time) / corgi::kMillisecondsPerSecond;
-    patron_data->time_in_move_state += delta_seconds;
-    patron_data->time_in_state += delta_seconds;
-    if (IgnoredMoveState(patron_data->move_state)) {
-      patron_data->time_being_ignored += delta_seconds;
+      default:
+        break;
     }
   }
-  if (event_time_ >= 0) {
-    event_time_ += delta_time;
+
+  // Update timers.
+  const float delta_seconds =
+      static_cast<float>(delta_time) / corgi::kMillisecondsPerSecond;
+  patron_data->time_in_move_state += delta_seconds;
+  patron_data->time_in_state += delta_seconds;
+  if (IgnoredMoveState(patron_data->move_state)) {
+    patron_data->time_being_ignored += delta_seconds;
   }
 }
 
@@ -757,13 +927,37 @@ vec3 PatronComponent::RaftPosition() const {
   return raft_transform->position;
 }
 
-const EntityRef* PatronComponent::ClosestProjectile(
-    const EntityRef& patron, vec3* closest_position,
-    motive::Angle* closest_face_angle, float* closest_time) const {
+// Gather the movement state of every projectile, and index the projectiles by
+// where they'll travel. Patrons can then search only the projectiles that pass
+// near them, instead of every projectile in the world.
+void PatronComponent::UpdateProjectileGrid() {
   // TODO: change projectile_component to const when Component gets a
   //       const_iterator.
   PlayerProjectileComponent* projectile_component =
       entity_manager_->GetComponent<PlayerProjectileComponent>();
+  projectiles_.clear();
+  projectile_grid_.Clear();
+  for (auto it = projectile_component->begin();
+       it != projectile_component->end(); ++it) {
+    const TransformData* projectile_transform =
+        entity_manager_->GetComponentData<TransformData>(it->entity);
+    const PhysicsData* projectile_physics =
+        entity_manager_->GetComponentData<PhysicsData>(it->entity);
+    ProjectileState projectile;
+    projectile.entity = it->entity;
+    projectile.position = projectile_transform->position;
+    projectile.velocity = projectile_physics->Velocity();
+    projectile_grid_.Add(projectile.position, projectile.velocity,
+                         max_catch_time_for_search_,
+                         static_cast<int>(projectiles_.size()));
+    projectiles_.push_back(projectile);
+  }
+  projectile_grid_.Finalize();
+}
+
+const EntityRef* PatronComponent::ClosestProjectile(
+    const EntityRef& patron, vec3* closest_position,
+    motive::Angle* closest_face_angle, float* closest_time) const {
   const TransformData* patron_transform = Data<TransformData>(patron);
   const PatronData* patron_data = GetComponentData(patron);
 
@@ -775,21 +969,22 @@ const EntityRef* PatronComponent::ClosestProjectile(
   // Gather data about the raft, which is needed in the calculations.
   const vec3 raft_position_xy = ZeroHeight(RaftPosition());
 
-  // Loop through every projectile. Keep a reference to the closest one.
+  // Loop through every projectile whose trajectory passes near the patron.
+  // Keep a reference to the closest one.
   const EntityRef* closest_ref = nullptr;
   float max_dist_sq = patron_data->max_catch_distance_for_search *
                       patron_data->max_catch_distance_for_search;
   float closest_dist_sq = max_dist_sq;
   vec3 closest_position_xy = mathfu::kZeros3f;
-  for (auto it = projectile_component->begin();
-       it != projectile_component->end(); ++it) {
+  projectile_grid_.Query(patron_transform->position,
+                         patron_data->max_catch_distance_for_search,
+                         &nearby_projectiles_);
+  for (auto it = nearby_projectiles_.begin(); it != nearby_projectiles_.end();
+       ++it) {
     // Get movement state of projectile.
-    const TransformData* projectile_transform =
-        entity_manager_->GetComponentData<TransformData>(it->entity);
-    const PhysicsData* projectile_physics =
-        entity_manager_->GetComponentData<PhysicsData>(it->entity);
-    const vec3 projectile_position = projectile_transform->position;
-    const vec3 projectile_velocity = projectile_physics->Velocity();  // In m/s.
+    const ProjectileState& projectile = projectiles_[*it];
+    const vec3 projectile_position = projectile.position;
+    const vec3 projectile_velocity = projectile.velocity;  // In m/s.
     const vec3 projectile_position_xy = ZeroHeight(projectile_position);
     const vec3 projectile_velocity_xy = ZeroHeight(projectile_velocity);
 
@@ -851,7 +1046,7 @@ const EntityRef* PatronComponent::ClosestProjectile(
     *closest_time = closest_t;
     *closest_face_angle = motive::Angle::FromYXVector(projectile_position_xy -
                                                       intercept_position_xy);
-    closest_ref = &it->entity;
+    closest_ref = &projectile.entity;
     closest_dist_sq = dist_sq;
   }
 
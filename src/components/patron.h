@@ -15,6 +15,8 @@
 #ifndef COMPONENTS_PATRON_H_
 #define COMPONENTS_PATRON_H_
 
+#include <stdint.h>
+#include <vector>
 #include "breadboard/event.h"
 #include "breadboard/graph.h"
 #include "breadboard/graph_state.h"
@@ -31,10 +33,16 @@
 #include "motive/math/angle.h"
 #include "motive/math/range.h"
 #include "motive/motivator.h"
+#include "spatial_grid.h"
 
 namespace fpl {
 namespace zooshi {
 
+// Width, in meters, of the cells of the grid used to find projectiles near
+// patrons. Projectile trajectories are long, so cells somewhat larger than
+// the patrons' catch search distance keep the grid cheap to rebuild.
+static const float kProjectileGridCellSize = 20.0f;
+
 enum PatronState {
   // Laying down in wait for the raft to come in range. If this patron has been
   // fed this lap, it will not stand up again until the next lap.
@@ -269,9 +277,74 @@ struct PatronData {
   bool play_eating_animation;
 };
 
+// A projectile's movement state, gathered once per frame so that each patron
+// doesn't have to look it up again while searching for sushi to catch.
+struct ProjectileState {
+  corgi::EntityRef entity;
+  mathfu::vec3 position;
+  mathfu::vec3 velocity;  // In m/s.
+};
+
+// The few fields that decide whether a patron needs a full update this frame,
+// packed into parallel arrays so they can be scanned without touching the
+// rest of PatronData.
+struct PatronHotState {
+  void Clear() {
+    entities.clear();
+    Resize(0);
+  }
+
+  void Resize(size_t size) {
+    asleep.resize(size);
+    awake.resize(size);
+    position_x.resize(size);
+    position_y.resize(size);
+    position_z.resize(size);
+    last_lap_upright.resize(size);
+    min_lap.resize(size);
+    max_lap.resize(size);
+    pop_in_value_start.resize(size);
+    pop_in_value_end.resize(size);
+    pop_in_time_start.resize(size);
+    pop_in_time_end.resize(size);
+    pending_seconds.resize(size);
+  }
+
+  std::vector<corgi::EntityRef> entities;
+
+  // Non-zero for patrons that are laying down, hidden, and not moving.
+  std::vector<uint8_t> asleep;
+
+  // Non-zero for patrons that get a full update this frame.
+  std::vector<uint8_t> awake;
+
+  // Position of the patron, from TransformData.
+  std::vector<float> position_x;
+  std::vector<float> position_y;
+  std::vector<float> position_z;
+
+  // Copies of the PatronData fields used by ShouldAppear().
+  std::vector<float> last_lap_upright;
+  std::vector<float> min_lap;
+  std::vector<float> max_lap;
+  std::vector<float> pop_in_value_start;
+  std::vector<float> pop_in_value_end;
+  std::vector<float> pop_in_time_start;
+  std::vector<float> pop_in_time_end;
+
+  // Seconds that have elapsed while the patron was asleep, and that have not
+  // yet been added to its timers.
+  std::vector<float> pending_seconds;
+};
+
 class PatronComponent : public corgi::Component<PatronData> {
  public:
-  PatronComponent() : config_(nullptr), event_time_(-1) {}
+  PatronComponent()
+      : config_(nullptr),
+        event_time_(-1),
+        max_catch_time_for_search_(0.0f),
+        projectile_grid_(kProjectileGridCellSize),
+        hot_state_dirty_(true) {}
   virtual ~PatronComponent() {}
 
   virtual void Init();
@@ -279,6 +352,7 @@ class PatronComponent : public corgi::Component<PatronData> {
   virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
   virtual void InitEntity(corgi::EntityRef& entity);
   virtual void UpdateAllEntities(corgi::WorldTime delta_time);
+  virtual void CleanupEntity(corgi::EntityRef& entity);
 
   void UpdateAndEnablePhysics();
 
@@ -328,16 +402,49 @@ class PatronComponent : public corgi::Component<PatronData> {
                                             motive::Angle* closest_face_angle,
                                             float* closest_time) const;
   void FindProjectileAndCatch(const corgi::EntityRef& patron);
+  void UpdateProjectileGrid();
   void MoveToTarget(const corgi::EntityRef& patron,
                     const mathfu::vec3& target_position,
                     motive::Angle target_face_angle, float target_time);
   bool ShouldReturnToIdle(const corgi::EntityRef& patron) const;
   void FaceRaft(const corgi::EntityRef& patron);
+  void UpdatePatron(const corgi::EntityRef& patron,
+                    corgi::WorldTime delta_time,
+                    const RailDenizenData* raft_rail_denizen);
+  void SyncHotState();
+  void RefreshHotState(size_t i, bool hidden);
+  void KeepAsleepPatronsHidden();
+  void FindAwakePatrons(const mathfu::vec3& raft_position, float lap,
+                        float delta_seconds);
 
   const Config* config_;
 
   // Current time into the "event". i.e. the set-up sequence of animations.
   corgi::WorldTime event_time_;
+
+  // Longest `catch_time_for_search` of any patron. Projectile trajectories
+  // are added to the grid for this long.
+  float max_catch_time_for_search_;
+
+  // All the projectiles in the world this frame. Indexed by the grid.
+  std::vector<ProjectileState> projectiles_;
+
+  // Spatial index of `projectiles_`, rebuilt every frame.
+  SpatialGrid projectile_grid_;
+
+  // Scratch buffer for grid queries, kept to avoid reallocating.
+  mutable std::vector<int> nearby_projectiles_;
+
+  // Packed copy of the fields checked every frame for every patron.
+  PatronHotState hot_state_;
+
+  // Indices into `hot_state_` of the patrons that get a full update this
+  // frame.
+  std::vector<size_t> awake_patrons_;
+
+  // True when patrons have been added, removed, or reset, and `hot_state_`
+  // has to be rebuilt.
+  bool hot_state_dirty_;
 };
 
 }  // zooshi
@@ -46,16 +46,22 @@ void PlayerComponent::Init() {
   config_ = entity_manager_->GetComponent<ServicesComponent>()->config();
 }
 void PlayerComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
+  // Input is only read once per frame, on the first tick, so a catch up tick
+  // doesn't fire the same button press again.
+  const bool catch_up_tick =
+      entity_manager_->GetComponent<ServicesComponent>()
+          ->world()
+          ->catch_up_tick;
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
     PlayerData* player_data = Data<PlayerData>(iter->entity);
     TransformData* transform_data = Data<TransformData>(iter->entity);
-    if (state_ != kPlayerState_Disabled) {
+    if (state_ != kPlayerState_Disabled && !catch_up_tick) {
       player_data->input_controller()->Update();
     }
     transform_data->orientation =
         mathfu::quat::RotateFromTo(player_data->GetFacing(), mathfu::kAxisY3f);
-    if (state_ == kPlayerState_Active &&
+    if (state_ == kPlayerState_Active && !catch_up_tick &&
         player_data->input_controller()->Button(kFireProjectile).Value() &&
         player_data->input_controller()->Button(kFireProjectile).HasChanged()) {
       SpawnProjectile(iter->entity);
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <limits>
 #include "breadboard/event.h"
 #include "components/rail_node.h"
@@ -32,7 +33,9 @@
 #include "fplbase/flatbuffer_utils.h"
 #include "fplbase/utilities.h"
 #include "mathfu/constants.h"
+#include "mathfu/utilities.h"
 #include "motive/init.h"
+#include "motive/math/curve.h"
 #include "rail_def_generated.h"
 #include "scene_lab/scene_lab.h"
 
@@ -53,6 +56,9 @@ using corgi::component_library::TransformData;
 using corgi::component_library::TransformComponent;
 using scene_lab::SceneLab;
 
+// Number of denizens whose transforms are computed by each job.
+static const size_t kTransformChunkSize = 64;
+
 void Rail::Positions(float delta_time,
                      std::vector<mathfu::vec3_packed>* positions) const {
   const size_t num_positions =
@@ -71,6 +77,41 @@ vec3 Rail::PositionCalculatedSlowly(float time) const {
   return position;
 }
 
+void Rail::SortedPositionsAndDirections(const float* times, size_t count,
+                                        mathfu::vec3_packed* positions,
+                                        mathfu::vec3_packed* directions) const {
+  // Evaluate one dimension at a time. The splines may not share their nodes,
+  // so each keeps its own current segment.
+  for (int d = 0; d < kDimensions; ++d) {
+    const motive::CompactSpline& spline = splines_[d];
+    motive::CompactSplineIndex index = 0;
+    motive::CompactSplineIndex curve_index = motive::kInvalidSplineIndex;
+    motive::CubicCurve curve;
+    for (size_t i = 0; i < count; ++i) {
+      const float x = mathfu::Clamp(times[i], spline.StartX(), spline.EndX());
+      index = spline.IndexForX(x, index);
+      // The end of the spline is past the last segment.
+      if (index > spline.LastSegmentIndex()) {
+        index = spline.LastSegmentIndex();
+      }
+      if (index != curve_index) {
+        curve.Init(spline.CreateCubicInit(index));
+        curve_index = index;
+      }
+      const float x_local = x - spline.NodeX(index);
+      positions[i].data[d] = curve.Evaluate(x_local);
+      directions[i].data[d] = curve.Derivative(x_local);
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const vec3 derivative(directions[i]);
+    const float length = derivative.Length();
+    directions[i] = mathfu::vec3_packed(
+        length > 0.0f ? derivative / length : mathfu::kAxisY3f);
+  }
+}
+
 void RailDenizenData::Initialize(const Rail& rail,
                                  motive::MotiveEngine& engine) {
   const motive::SplinePlayback playback(start_time, true,
@@ -111,28 +152,24 @@ void RailDenizenComponent::Init() {
   }
 }
 
-void RailDenizenComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
-  for (auto iter = component_data_.begin(); iter != component_data_.end();
-       ++iter) {
-    RailDenizenData* rail_denizen_data = GetComponentData(iter->entity);
-    if (!rail_denizen_data->enabled) {
-      continue;
-    }
-    rail_denizen_data->SetSplinePlaybackRate(rail_denizen_data->PlaybackRate());
-    TransformData* transform_data = Data<TransformData>(iter->entity);
-    vec3 position = rail_denizen_data->rail_orientation.Inverse() *
-                    rail_denizen_data->Position();
+// Compute and write back the transforms of `batch_[begin, end)`. Each entry
+// only touches its own denizen, so disjoint ranges can run in parallel.
+void RailDenizenComponent::UpdateTransforms(size_t begin, size_t end,
+                                            float orientation_delta_time) {
+  for (size_t i = begin; i < end; ++i) {
+    const BatchEntry& entry = batch_[i];
+    RailDenizenData* rail_denizen_data = entry.data;
+    TransformData* transform_data = entry.transform;
+    vec3 position =
+        rail_denizen_data->rail_orientation.Inverse() * vec3(entry.position);
     position *= rail_denizen_data->rail_scale;
     position += rail_denizen_data->rail_offset;
     transform_data->position = position;
     if (rail_denizen_data->update_orientation) {
       float convergence_rate = rail_denizen_data->orientation_convergence_rate;
-      const motive::Motivator3f& motivator =
-          convergence_rate == 0.0f ? rail_denizen_data->motivator
-                                   : rail_denizen_data->orientation_motivator;
       mathfu::quat target_orientation =
           rail_denizen_data->rail_orientation *
-          mathfu::quat::RotateFromTo(motivator.Direction(), mathfu::kAxisY3f);
+          mathfu::quat::RotateFromTo(vec3(entry.direction), mathfu::kAxisY3f);
       // Convergence is disabled when the playback rate is zero as
       // it's possible for the slerp to yield an invalid quaternion
       // with angles approaching zero.
@@ -140,16 +177,120 @@ void RailDenizenComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
           rail_denizen_data->PlaybackRate() > 0.0f) {
         rail_denizen_data->interpolated_orientation = mathfu::quat::Slerp(
             rail_denizen_data->interpolated_orientation, target_orientation,
-            std::min(convergence_rate * static_cast<float>(delta_time) /
-                         static_cast<float>(corgi::kMillisecondsPerSecond),
-                     1.0f));
+            std::min(convergence_rate * orientation_delta_time, 1.0f));
         transform_data->orientation =
             rail_denizen_data->interpolated_orientation;
       } else {
         transform_data->orientation = target_orientation;
       }
     }
+  }
+}
+
+// Fill in the positions and directions of `batch_` from `samples_`.
+void RailDenizenComponent::EvaluateRails() {
+  std::sort(samples_.begin(), samples_.end(),
+            [](const RailSample& a, const RailSample& b) {
+              if (a.rail != b.rail) {
+                return std::less<const Rail*>()(a.rail, b.rail);
+              }
+              return a.time < b.time;
+            });
+
+  for (size_t begin = 0; begin < samples_.size();) {
+    const Rail* rail = samples_[begin].rail;
+    size_t end = begin + 1;
+    while (end < samples_.size() && samples_[end].rail == rail) {
+      ++end;
+    }
 
+    const size_t count = end - begin;
+    sample_times_.resize(count);
+    sample_positions_.resize(count);
+    sample_directions_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      sample_times_[i] = samples_[begin + i].time;
+    }
+    rail->SortedPositionsAndDirections(&sample_times_[0], count,
+                                       &sample_positions_[0],
+                                       &sample_directions_[0]);
+    for (size_t i = 0; i < count; ++i) {
+      const RailSample& sample = samples_[begin + i];
+      BatchEntry& entry = batch_[sample.entry];
+      if (sample.direction) {
+        entry.direction = sample_directions_[i];
+      } else {
+        entry.position = sample_positions_[i];
+      }
+    }
+    begin = end;
+  }
+}
+
+void RailDenizenComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
+  const float orientation_delta_time =
+      static_cast<float>(delta_time) /
+      static_cast<float>(corgi::kMillisecondsPerSecond);
+
+  // Read the spline times of all the enabled denizens, which the MotiveEngine
+  // has already advanced.
+  batch_.clear();
+  samples_.clear();
+  for (auto iter = component_data_.begin(); iter != component_data_.end();
+       ++iter) {
+    RailDenizenData* rail_denizen_data = &iter->data;
+    if (!rail_denizen_data->enabled) {
+      continue;
+    }
+    ReinitializeRebuiltRail(iter->entity);
+    rail_denizen_data->SetSplinePlaybackRate(rail_denizen_data->PlaybackRate());
+    const motive::Motivator3f& motivator =
+        rail_denizen_data->orientation_convergence_rate == 0.0f
+            ? rail_denizen_data->motivator
+            : rail_denizen_data->orientation_motivator;
+    BatchEntry entry;
+    entry.entity = iter->entity;
+    entry.data = rail_denizen_data;
+    entry.transform = Data<TransformData>(iter->entity);
+    entry.direction = mathfu::vec3_packed(mathfu::kAxisY3f);
+    const Rail* rail = rail_denizen_data->rail;
+    if (rail == nullptr) {
+      entry.position = mathfu::vec3_packed(rail_denizen_data->Position());
+      if (rail_denizen_data->update_orientation) {
+        entry.direction = mathfu::vec3_packed(motivator.Direction());
+      }
+    } else {
+      RailSample sample;
+      sample.rail = rail;
+      sample.entry = batch_.size();
+      sample.time =
+          static_cast<float>(rail_denizen_data->motivator.SplineTime());
+      sample.direction = false;
+      samples_.push_back(sample);
+      if (rail_denizen_data->update_orientation) {
+        sample.time = static_cast<float>(motivator.SplineTime());
+        sample.direction = true;
+        samples_.push_back(sample);
+      }
+    }
+    batch_.push_back(entry);
+  }
+
+  // Evaluate the rails, once for all the denizens on each.
+  EvaluateRails();
+
+  // Then compute and write back the transforms of the whole batch.
+  JobSystem* job_system =
+      entity_manager_->GetComponent<ServicesComponent>()->job_system();
+  job_system->ParallelFor(
+      batch_.size(), kTransformChunkSize,
+      [this, orientation_delta_time](size_t begin, size_t end) {
+        UpdateTransforms(begin, end, orientation_delta_time);
+      });
+
+  // Lap events are broadcast from this thread only.
+  for (auto entry = batch_.begin(); entry != batch_.end(); ++entry) {
+    RailDenizenData* rail_denizen_data = entry->data;
     float previous_progress = rail_denizen_data->lap_progress;
     motive::MotiveTime total = rail_denizen_data->motivator.SplineTime() +
                                rail_denizen_data->motivator.TargetTime();
@@ -162,7 +303,7 @@ void RailDenizenComponent::UpdateAllEntities(corgi::WorldTime delta_time) {
     // previous lap amount.
     if (rail_denizen_data->lap_progress < previous_progress) {
       rail_denizen_data->lap_number++;
-      GraphData* graph_data = Data<GraphData>(iter->entity);
+      GraphData* graph_data = Data<GraphData>(entry->entity);
       if (graph_data) {
         graph_data->broadcaster.BroadcastEvent(kNewLapEventId);
       }
@@ -230,14 +371,36 @@ void RailDenizenComponent::InitializeRail(corgi::EntityRef& entity) {
   if (data->rail_name != "") {
     motive::MotiveEngine& engine =
         entity_manager_->GetComponent<AnimationComponent>()->engine();
-    data->Initialize(*rail_manager->GetRailFromComponents(
-                         data->rail_name.c_str(), entity_manager_),
-                     engine);
+    data->rail = rail_manager->GetRailFromComponents(data->rail_name.c_str(),
+                                                     entity_manager_);
+    data->Initialize(*data->rail, engine);
+    data->rail_generation = rail_manager->RailGeneration(data->rail_name);
   } else {
     fplbase::LogError("RailDenizen: Error, no rail name specified");
   }
 }
 
+// Another holder of the rail (e.g. the river) may have re-fit it since this
+// denizen was initialized. The motivators then need to be given the new
+// splines, but the denizen keeps its place along the rail.
+void RailDenizenComponent::ReinitializeRebuiltRail(corgi::EntityRef& entity) {
+  RailDenizenData* data = GetComponentData(entity);
+  const int generation =
+      entity_manager_->GetComponent<ServicesComponent>()
+          ->rail_manager()
+          ->RailGeneration(data->rail_name);
+  if (generation == data->rail_generation) return;
+
+  const motive::MotiveTime time = data->motivator.SplineTime();
+  const motive::MotiveTime orientation_time =
+      data->orientation_motivator.SplineTime();
+  const float rate = data->PlaybackRate();
+  InitializeRail(entity);
+  data->motivator.SetSplineTime(time);
+  data->orientation_motivator.SetSplineTime(orientation_time);
+  data->playback_rate.SetTarget(motive::Target1f(rate, 0.0f, 0));
+}
+
 corgi::ComponentInterface::RawDataUniquePtr RailDenizenComponent::ExportRawData(
     const corgi::EntityRef& entity) const {
   const RailDenizenData* data = GetComponentData(entity);
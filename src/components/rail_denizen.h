@@ -20,6 +20,7 @@
 #include "breadboard/event.h"
 #include "components_generated.h"
 #include "corgi/component.h"
+#include "corgi_component_library/transform.h"
 #include "mathfu/constants.h"
 #include "mathfu/glsl_mappings.h"
 #include "motive/math/compact_spline.h"
@@ -38,6 +39,8 @@ struct RailDenizenData {
         total_lap_progress(0.0f),
         initial_playback_rate(0.0f),
         start_time(0.0f),
+        rail_generation(0),
+        rail(nullptr),
         motivator(),
         orientation_motivator(),
         playback_rate(),
@@ -82,6 +85,11 @@ struct RailDenizenData {
   float total_lap_progress;
   float initial_playback_rate;
   float start_time;
+  // RailManager::RailGeneration() of the rail the motivators were last
+  // initialized with.
+  int rail_generation;
+  // The rail the motivators follow, or null if it could not be found.
+  const Rail* rail;
   motive::Motivator3f motivator;
   // Look ahead used to calculate the interpolated orientation of the denizen.
   motive::Motivator3f orientation_motivator;
@@ -123,8 +131,38 @@ class RailDenizenComponent : public corgi::Component<RailDenizenData> {
   void PostLoadFixup();
 
  private:
+  // The rail values of an enabled denizen, gathered so that all the
+  // transforms are computed in one pass.
+  struct BatchEntry {
+    corgi::EntityRef entity;
+    RailDenizenData* data;
+    corgi::component_library::TransformData* transform;
+    mathfu::vec3_packed position;
+    mathfu::vec3_packed direction;
+  };
+
+  // A time along `rail` at which the position (or the direction) of
+  // `batch_[entry]` is evaluated. Sorted by rail and time, so that each rail
+  // is evaluated for all its denizens at once.
+  struct RailSample {
+    const Rail* rail;
+    float time;
+    size_t entry;
+    bool direction;
+  };
+
   void InitializeRail(corgi::EntityRef&);
+  void ReinitializeRebuiltRail(corgi::EntityRef& entity);
   void OnEnterEditor();
+  void EvaluateRails();
+  void UpdateTransforms(size_t begin, size_t end, float orientation_delta_time);
+
+  // Scratch buffers for UpdateAllEntities(), kept to avoid reallocating.
+  std::vector<BatchEntry> batch_;
+  std::vector<RailSample> samples_;
+  std::vector<float> sample_times_;
+  std::vector<mathfu::vec3_packed> sample_positions_;
+  std::vector<mathfu::vec3_packed> sample_directions_;
 };
 
 }  // zooshi
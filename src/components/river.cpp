@@ -14,7 +14,14 @@
 
 #include "components/river.h"
 #include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
 #include <memory>
+#include "SDL_atomic.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
 #include "common.h"
 #include "components/rail_denizen.h"
 #include "components/rail_node.h"
@@ -25,8 +32,12 @@
 #include "corgi_component_library/rendermesh.h"
 #include "corgi_component_library/transform.h"
 #include "fplbase/utilities.h"
+#include "frustum.h"
+#include "river_random.h"
 #include "scene_lab/scene_lab.h"
+#include "trace.h"
 
+using mathfu::mat4;
 using mathfu::vec2;
 using mathfu::vec2_packed;
 using mathfu::vec3;
@@ -46,10 +57,14 @@ namespace zooshi {
 using corgi::component_library::PhysicsComponent;
 using corgi::component_library::RenderMeshComponent;
 using corgi::component_library::RenderMeshData;
+using corgi::component_library::TransformData;
 using scene_lab::SceneLab;
 
 static const size_t kNumIndicesPerQuad = 6;
 
+// Number of vertices that 16-bit indices can address.
+static const size_t kMaxIndexedVertices = 65536;
+
 // A vertex definition specific to normalmapping with colors.
 struct NormalMappedColorVertex {
   vec3_packed pos;
@@ -59,12 +74,166 @@ struct NormalMappedColorVertex {
   unsigned char color[4];
 };
 
+// The vertices uploaded to the GPU, with only the attributes that the water
+// and bank shaders read. Positions are relative to the chunk's origin.
+struct RiverVertex {
+  vec3_packed pos;
+  vec2_packed tc;
+};
+
+struct BankVertex {
+  vec3_packed pos;
+  vec2_packed tc;
+  vec3_packed norm;
+  unsigned char color[4];
+};
+
+// A chunk of the water or bank mesh: the slice of the vertices that the
+// chunk's segments use, and its indices, which are relative to `vert_begin`.
+// The chunk's vertices are uploaded relative to `origin`, the center of their
+// bounds, starting at `upload_begin` in the job's upload buffer.
+struct RiverMeshPiece {
+  RiverMeshPiece() : vert_begin(0), vert_end(0), zone(0), upload_begin(0) {}
+  size_t vert_begin;
+  size_t vert_end;
+  unsigned int zone;
+  std::vector<unsigned short> indices;
+  size_t upload_begin;
+  vec3_packed origin;
+  vec3_packed min_position;
+  vec3_packed max_position;
+};
+
+// Generates the CPU-side data for a river's meshes on a worker thread. The
+// buffers are kept between generations, so regenerating the river doesn't
+// reallocate them, and only the segments whose part of the track moved have
+// to be regenerated.
+struct RiverMeshJob {
+  RiverMeshJob()
+      : river(nullptr),
+        random_seed(0),
+        regenerate_all(true),
+        changed(false),
+        changed_all(false),
+        worker(nullptr) {
+    SDL_AtomicSet(&finished, 0);
+  }
+  ~RiverMeshJob() { Wait(); }
+
+  // Queue the job on `mesh_worker`. The inputs must have been set up.
+  void Start(RiverMeshWorker* mesh_worker);
+
+  // Block until the worker has finished the job.
+  void Wait();
+
+  // True between Start() and Wait().
+  bool Running() const { return worker != nullptr; }
+
+  // True once the outputs are ready to be read.
+  bool Finished() { return SDL_AtomicGet(&finished) != 0; }
+
+  void Generate();
+  void GenerateAll();
+  bool GenerateChanged();
+  void AssignZones();
+  bool GenerateSegment(size_t i);
+  void GenerateIndices();
+  void ComputeNormals(size_t begin, size_t end);
+  void PackPieces();
+
+  // Inputs, gathered on the render thread.
+  const RiverConfig* river;
+  std::vector<vec3_packed> track;
+  std::vector<bool> zone_single_texture;
+  unsigned int random_seed;
+
+  // The track that the current outputs were generated from.
+  std::vector<vec3_packed> previous_track;
+
+  // If false, only the segments affected by the difference between `track`
+  // and `previous_track` are regenerated.
+  bool regenerate_all;
+
+  // The zone of each segment, and the fraction of the river at which each
+  // zone ends. Only depend on the number of segments.
+  std::vector<unsigned int> bank_zones;
+  std::vector<float> actual_zone_end;
+
+  // Outputs, read by the render thread once the job has finished.
+  // The bank indices address all of `bank_verts`, so they're 32-bit. Each
+  // piece has few enough vertices for 16-bit indices.
+  std::vector<NormalMappedVertex> river_verts;
+  std::vector<RiverMeshPiece> river_pieces;
+  std::vector<RiverVertex> river_upload_verts;
+  std::vector<NormalMappedColorVertex> bank_verts;
+  std::vector<uint32_t> bank_indices;
+  std::vector<RiverMeshPiece> bank_pieces;
+  std::vector<BankVertex> bank_upload_verts;
+
+  // False if the outputs are the same as before the job ran.
+  bool changed;
+
+  // True if the whole river was regenerated, rather than only the segments
+  // around an edit.
+  bool changed_all;
+
+  // Scratch buffers for GenerateSegment() and ComputeNormals().
+  std::vector<vec2> offsets;
+  std::vector<NormalMappedColorVertex> window_verts;
+  std::vector<unsigned short> window_indices;
+
+  // The worker the job was queued on, until Wait() returns.
+  RiverMeshWorker* worker;
+  SDL_atomic_t finished;
+};
+
+// A single long-lived thread that runs river mesh jobs in the order they were
+// queued, so that regenerating a river doesn't start a new thread each time.
+class RiverMeshWorker {
+ public:
+  RiverMeshWorker();
+  ~RiverMeshWorker();
+
+  void Submit(RiverMeshJob* job);
+
+  // Block until `job` has finished.
+  void WaitFor(RiverMeshJob* job);
+
+ private:
+  void Loop();
+  static int Run(void* data);
+
+  // Guards `jobs_` and `exiting_`, and is used with the condition variables.
+  SDL_mutex* mutex_;
+  SDL_cond* start_cv_;
+  SDL_cond* done_cv_;
+  std::deque<RiverMeshJob*> jobs_;
+  bool exiting_;
+  SDL_Thread* thread_;
+};
+
+static inline bool SamePosition(const vec3_packed& a, const vec3_packed& b) {
+  return a.data[0] == b.data[0] && a.data[1] == b.data[1] &&
+         a.data[2] == b.data[2];
+}
+
+RiverComponent::RiverComponent()
+    : river_offset_(0.0f), create_render_meshes_(true) {}
+
+RiverComponent::~RiverComponent() {
+  // The jobs must be done with the worker before it goes away.
+  for (auto iter = begin(); iter != end(); ++iter) {
+    RiverMeshJob* job = iter->data.mesh_job.get();
+    if (job != nullptr) job->Wait();
+  }
+}
+
 void RiverComponent::Init() {
   auto services = entity_manager_->GetComponent<ServicesComponent>();
   SceneLab* scene_lab = services->scene_lab();
   if (scene_lab) {
     scene_lab->AddOnUpdateEntityCallback(
-        [this](const corgi::EntityRef& /*entity*/) { TriggerRiverUpdate(); });
+        [this](const corgi::EntityRef& entity) { UpdateRiverMeshes(entity); });
   }
   river_offset_ = 0;
 }
@@ -77,7 +246,7 @@ void RiverComponent::AddFromRawData(corgi::EntityRef& entity,
   river_data->random_seed = river_def->random_seed();
 
   entity_manager_->AddEntityToComponent<RenderMeshComponent>(entity);
-  TriggerRiverUpdate();
+  river_data->render_mesh_needs_update_ = true;
 }
 
 // The update function here really just handles keeping the river offset
@@ -94,13 +263,15 @@ void RiverComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
   river_offset_ -= floor(river_offset_);
 }
 
-void RiverComponent::TriggerRiverUpdate() {
-  // TODO - it would be nice if this only updated the river that we were editing
-  // (instead of marking all rivers as needing an update) but due to how river
-  // edit nodes interact with the river mesh, that's tricky.
+// Marks the rivers that follow `rail_name` as needing an update, or all
+// rivers if `rail_name` is null. Only the segments whose part of the track
+// actually moved get regenerated, so marking a river is cheap.
+void RiverComponent::TriggerRiverUpdate(const std::string* rail_name) {
   for (auto iter = begin(); iter != end(); ++iter) {
     RiverData* river_data = Data<RiverData>(iter->entity);
-    river_data->render_mesh_needs_update_ = true;
+    if (rail_name == nullptr || river_data->rail_name == *rail_name) {
+      river_data->render_mesh_needs_update_ = true;
+    }
   }
 }
 
@@ -123,89 +294,266 @@ corgi::ComponentInterface::RawDataUniquePtr RiverComponent::ExportRawData(
   return fbb.ReleaseBufferPointer();
 }
 
-// Iterate through the river meshes and update any of them that need to be
-// regenerated.  Split out into a separate function so it can be called from
-// the render thread.  (Warning:  Crashes if you try to call it on the main
-// thread, because it doesn't have access to the opengl context!)
+// Iterate through the river meshes, swap in any meshes that have finished
+// generating, and start generating the ones that need to be updated. Split
+// out into a separate function so it can be called from the render thread.
+// (Warning:  Crashes if you try to call it on the main thread, because it
+// doesn't have access to the opengl context!)
 void RiverComponent::UpdateRiverMeshes() {
   for (auto iter = begin(); iter != end(); ++iter) {
     RiverData* river_data = Data<RiverData>(iter->entity);
-    if (river_data->render_mesh_needs_update_) CreateRiverMesh(iter->entity);
+    RiverMeshJob* job = river_data->mesh_job.get();
+    if (job != nullptr && job->Running()) {
+      // Keep rendering the old mesh until the new one is ready.
+      if (!job->Finished()) continue;
+      SwapInRiverMesh(iter->entity);
+    }
+    if (river_data->render_mesh_needs_update_) StartRiverMesh(iter->entity);
   }
 }
 
-// Generates the actual mesh for the river, and adds it to this entitiy's
-// rendermesh component.
-void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
-  static const fplbase::Attribute kMeshFormat[] = {
-      fplbase::kPosition3f, fplbase::kTexCoord2f, fplbase::kNormal3f,
-      fplbase::kTangent4f, fplbase::kEND};
-  static const fplbase::Attribute kBankMeshFormat[] = {
-      fplbase::kPosition3f, fplbase::kTexCoord2f, fplbase::kNormal3f,
-      fplbase::kTangent4f,  fplbase::kColor4ub,   fplbase::kEND};
-  std::vector<vec3_packed> track;
+void RiverComponent::FinishRiverMeshes() {
+  for (auto iter = begin(); iter != end(); ++iter) {
+    RiverData* river_data = Data<RiverData>(iter->entity);
+    RiverMeshJob* job = river_data->mesh_job.get();
+    if (job != nullptr && job->Running()) SwapInRiverMesh(iter->entity);
+  }
+}
+
+// Wait for the worker thread, and replace the river's meshes and physics with
+// its outputs if they changed.
+void RiverComponent::SwapInRiverMesh(corgi::EntityRef& entity) {
+  RiverData* river_data = Data<RiverData>(entity);
+  RiverMeshJob* job = river_data->mesh_job.get();
+  {
+    TraceScope scope("RiverMeshWait");
+    job->Wait();
+  }
+  if (!job->changed) return;
+  TraceScope scope("RiverMeshSwap");
+  if (create_render_meshes_) UploadRiverMesh(entity);
+  CreateRiverPhysics(entity);
+}
+
+// Gather everything the mesh generation needs from the entity system and the
+// asset manager, and queue the mesh to be generated on the worker thread.
+void RiverComponent::StartRiverMesh(corgi::EntityRef& entity) {
   const RiverConfig* river = entity_manager_->GetComponent<ServicesComponent>()
                                  ->config()
                                  ->river_config();
 
   RiverData* river_data = Data<RiverData>(entity);
   river_data->render_mesh_needs_update_ = false;
-
-  // Initialize the static mesh that will be made around the river banks.
-  auto* physics_component = entity_manager_->GetComponent<PhysicsComponent>();
-  physics_component->InitStaticMesh(entity);
+  if (!river_data->mesh_job) {
+    river_data->mesh_job.reset(new RiverMeshJob());
+  }
+  RiverMeshJob* job = river_data->mesh_job.get();
+  if (job->river != river) {
+    job->river = river;
+    job->regenerate_all = true;
+  }
 
   Rail* rail = entity_manager_->GetComponent<ServicesComponent>()
                    ->rail_manager()
                    ->GetRailFromComponents(river_data->rail_name.c_str(),
                                            entity_manager_);
 
-  // Generate the spline data and store it in our track vector:
-  rail->Positions(river->spline_stepsize(), &track);
+  // Generate the spline data and store it in our track vector. Keep the old
+  // track around so that the job can tell which segments moved.
+  job->previous_track.swap(job->track);
+  rail->Positions(river->spline_stepsize(), &job->track);
+  if (job->track.size() != job->previous_track.size()) {
+    job->regenerate_all = true;
+  }
 
+  // Materials have to be loaded here, on the render thread.
   fplbase::AssetManager* asset_manager =
       entity_manager_->GetComponent<ServicesComponent>()->asset_manager();
+  const unsigned int num_zones = river->zones()->Length();
+  job->zone_single_texture.resize(num_zones);
+  for (unsigned int zone = 0; zone < num_zones; zone++) {
+    Material* bank_material = asset_manager->LoadMaterial(
+        river->zones()->Get(zone)->material()->c_str());
+    const bool single_texture = bank_material->textures().size() == 1;
+    if (job->zone_single_texture[zone] != single_texture) {
+      job->zone_single_texture[zone] = single_texture;
+      job->regenerate_all = true;
+    }
+  }
+
+  // The random bank offsets are a function of the seed.
+  if (job->random_seed != river_data->random_seed) {
+    job->random_seed = river_data->random_seed;
+    job->regenerate_all = true;
+  }
+
+  if (!mesh_worker_) mesh_worker_.reset(new RiverMeshWorker());
+  job->Start(mesh_worker_.get());
+}
 
+RiverMeshWorker::RiverMeshWorker()
+    : mutex_(SDL_CreateMutex()),
+      start_cv_(SDL_CreateCond()),
+      done_cv_(SDL_CreateCond()),
+      exiting_(false) {
+  thread_ = SDL_CreateThread(Run, "Zooshi River Mesh Thread", this);
+  if (!thread_) {
+    fplbase::LogError("Error creating river mesh thread.");
+  }
+}
+
+RiverMeshWorker::~RiverMeshWorker() {
+  SDL_LockMutex(mutex_);
+  exiting_ = true;
+  SDL_CondSignal(start_cv_);
+  SDL_UnlockMutex(mutex_);
+  if (thread_ != nullptr) SDL_WaitThread(thread_, nullptr);
+  SDL_DestroyCond(done_cv_);
+  SDL_DestroyCond(start_cv_);
+  SDL_DestroyMutex(mutex_);
+}
+
+void RiverMeshWorker::Submit(RiverMeshJob* job) {
+  if (thread_ == nullptr) {
+    // Fall back to generating the mesh on this thread.
+    job->Generate();
+    SDL_AtomicSet(&job->finished, 1);
+    return;
+  }
+  SDL_LockMutex(mutex_);
+  jobs_.push_back(job);
+  SDL_CondSignal(start_cv_);
+  SDL_UnlockMutex(mutex_);
+}
+
+void RiverMeshWorker::WaitFor(RiverMeshJob* job) {
+  SDL_LockMutex(mutex_);
+  while (!job->Finished()) {
+    SDL_CondWait(done_cv_, mutex_);
+  }
+  SDL_UnlockMutex(mutex_);
+}
+
+// Runs on the worker thread. Jobs that are still queued when the worker is
+// destroyed are finished first.
+void RiverMeshWorker::Loop() {
+  SDL_LockMutex(mutex_);
+  while (true) {
+    while (!exiting_ && jobs_.empty()) {
+      SDL_CondWait(start_cv_, mutex_);
+    }
+    if (jobs_.empty()) break;
+    RiverMeshJob* job = jobs_.front();
+    jobs_.pop_front();
+    SDL_UnlockMutex(mutex_);
+    job->Generate();
+    SDL_AtomicSet(&job->finished, 1);
+    SDL_LockMutex(mutex_);
+    SDL_CondBroadcast(done_cv_);
+  }
+  SDL_UnlockMutex(mutex_);
+}
+
+int RiverMeshWorker::Run(void* data) {
+  static_cast<RiverMeshWorker*>(data)->Loop();
+  return 0;
+}
+
+void RiverMeshJob::Start(RiverMeshWorker* mesh_worker) {
+  assert(!Running());
+  SDL_AtomicSet(&finished, 0);
+  worker = mesh_worker;
+  worker->Submit(this);
+}
+
+void RiverMeshJob::Wait() {
+  if (worker != nullptr) {
+    worker->WaitFor(this);
+    worker = nullptr;
+  }
+}
+
+// Generates the vertices and indices for the river and its banks, which the
+// static physics mesh shares. Only reads the job's inputs and the (immutable)
+// config, so it's safe to run on any thread.
+void RiverMeshJob::Generate() {
+  changed_all = regenerate_all || !GenerateChanged();
+  if (changed_all) GenerateAll();
+  regenerate_all = false;
+  if (changed) PackPieces();
+}
+
+void RiverMeshJob::GenerateAll() {
   const size_t num_bank_contours = river->default_banks()->Length();
-  const size_t num_bank_quads = num_bank_contours - 2;
   const size_t river_idx = river->river_index();
   const size_t segment_count = track.size();
   const size_t river_vert_max = segment_count * 2;
-  const size_t river_index_max = (segment_count - 1) * kNumIndicesPerQuad;
   const size_t bank_vert_max = segment_count * num_bank_contours;
-  const size_t bank_index_max =
-      (segment_count - 1) * kNumIndicesPerQuad * num_bank_quads;
   assert(num_bank_contours >= 2 && river_idx < num_bank_contours - 1);
-  const unsigned int num_zones = river->zones()->Length();
+  (void)river_idx;
 
-  // Need to allocate some space to plan out our mesh in:
-  std::vector<NormalMappedVertex> river_verts(river_vert_max);
-  river_verts.clear();
-  std::vector<unsigned short> river_indices(river_index_max);
-  river_indices.clear();
+  // The buffers keep their capacity from the previous generation, so these
+  // only allocate the first time, or when the river grows.
+  river_verts.resize(river_vert_max);
+  bank_verts.resize(bank_vert_max);
 
-  std::vector<NormalMappedColorVertex> bank_verts(bank_vert_max);
-  bank_verts.clear();
-  std::vector<unsigned short> bank_indices(bank_index_max);
-  bank_indices.clear();
-  // Use one set of bank vertices for the entire riverbank, but separate out
-  // the zones via indices, so we can use different materials (and possibly
-  // shaders) per zone. We still keep bank_indices for the normal calculation,
-  // though.
-  std::vector<std::vector<unsigned short>> bank_indices_by_zone;
-  bank_indices_by_zone.resize(num_zones);
-
-  std::vector<unsigned int> bank_zones;  // indexed by segment
-  bank_zones.resize(segment_count, 0);   // default of 0
-  unsigned int zone_id = 0;
+  AssignZones();
+
+  // Construct the actual mesh data for the river:
+  for (size_t i = 0; i < segment_count; i++) {
+    GenerateSegment(i);
+  }
+  GenerateIndices();
 
-  // TODO: Use a local random number generator. Resetting the global random
-  //       number generator is not a nice. Also, there's no guarantee that
-  //       mathfu::Random will continue to use rand().
-  srand(river_data->random_seed);
+  ComputeNormals(0, segment_count);
+  changed = true;
+}
+
+// Regenerates only the segments that are affected by the difference between
+// `previous_track` and `track`. Returns false if the whole river has to be
+// regenerated instead.
+bool RiverMeshJob::GenerateChanged() {
+  const size_t segment_count = track.size();
+  assert(previous_track.size() == segment_count);
+
+  // A segment depends on its own track position, the one before it, and,
+  // because of the tight corner fix, on the vertices of the previous segment.
+  size_t changed_begin = segment_count;
+  size_t changed_end = 0;
+  bool prev_changed = false;
+  for (size_t i = 0; i < segment_count; i++) {
+    const size_t prev_i = i == 0 ? segment_count - 1 : i - 1;
+    const bool track_changed =
+        !SamePosition(track[i], previous_track[i]) ||
+        !SamePosition(track[prev_i], previous_track[prev_i]);
+    if (!track_changed && !prev_changed) continue;
+
+    // The last segment is a copy of the first one, so changing the first
+    // segment means regenerating everything.
+    if (i == 0) return false;
+
+    prev_changed = GenerateSegment(i);
+    if (prev_changed) {
+      changed_begin = std::min(changed_begin, i);
+      changed_end = i + 1;
+    }
+  }
+  changed = changed_begin < changed_end;
+  if (!changed) return true;
+
+  // Normals depend on all the triangles around a vertex, so the vertices of
+  // the neighboring segments are affected too.
+  ComputeNormals(changed_begin - 1, std::min(changed_end + 1, segment_count));
+  return true;
+}
+
+// Assign each segment to a zone, based on how far along the river it is.
+void RiverMeshJob::AssignZones() {
+  const size_t segment_count = track.size();
+  bank_zones.assign(segment_count, 0);
+  actual_zone_end.assign(segment_count, 1);
+  unsigned int zone_id = 0;
 
-  std::vector<float> actual_zone_end;
-  actual_zone_end.resize(segment_count, 1);
   // Precalculate the actual zone end locations.
   for (size_t i = 0; i < segment_count; i++) {
     const float fraction =
@@ -216,162 +564,209 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
       zone_id = zone_id + 1;
     }
   }
+
   // Start over from zone 0.
   zone_id = 0;
-
-  const RiverZone* current_zone = river->zones()->Get(zone_id);
-  Material* current_bank_material =
-      asset_manager->LoadMaterial(current_zone->material()->c_str());
-  float river_width = current_zone->width() != 0 ? current_zone->width()
-                                                 : river->default_width();
-
-  // Construct the actual mesh data for the river:
-  std::vector<vec2> offsets(num_bank_contours);
   for (size_t i = 0; i < segment_count; i++) {
-    // River track is circular.
-    const size_t prev_i = i == 0 ? segment_count - 1 : i - 1;
-
-    // Get the current position on the track, and the normal (to the side).
-    const vec3 track_delta = vec3(track[i]) - vec3(track[prev_i]);
-    const vec3 track_normal =
-        vec3::CrossProduct(track_delta, kAxisZ3f).Normalized();
-    const vec3 track_position =
-        vec3(track[i]) + river->track_height() * kAxisZ3f;
-
-    // The river texture is tiled several times along the course of the river.
-    // TODO: Change this from tile count to actual physical size for a tile.
-    //       Requires that we know the total path distance.
-    const float texture_v = river->texture_tile_size() * static_cast<float>(i) /
-                            static_cast<float>(segment_count);
-
     // Fraction of the river we have gone through, approximately.
     const float fraction =
         static_cast<float>(i) / static_cast<float>(segment_count);
-
     if (fraction >= actual_zone_end[zone_id]) {
       zone_id = zone_id + 1;
-      current_zone = river->zones()->Get(zone_id);
-      // Each zone has its own texture.
-      current_bank_material =
-          asset_manager->LoadMaterial(current_zone->material()->c_str());
-      // Each zone has its own river width.
-      river_width = current_zone->width() != 0 ? current_zone->width()
-                                               : river->default_width();
-      current_bank_material = asset_manager->LoadMaterial(
-          river->zones()->Get(zone_id)->material()->c_str());
     }
     bank_zones[i] = zone_id;
-    float zone_start = zone_id == 0 ? 0 : actual_zone_end[zone_id - 1];
-    float zone_end = actual_zone_end[zone_id];
-    float within_fraction = (fraction - zone_start) / (zone_end - zone_start);
-    if (current_bank_material->textures().size() == 1) {
-      // Ensure we stay continuous with transitional zones.
-      within_fraction = within_fraction < 0.5f ? 1.0f : 0.0f;
-    }
+  }
+}
 
-    int within_color = static_cast<int>(255.0 * within_fraction);
-    // Cap the color to 0..255 byte.
-    unsigned char within_color_byte = static_cast<unsigned char>(
-        within_color < 0 ? 0 : (within_color > 255 ? 255 : within_color));
-
-    // Get the (side, up) offsets of the bank vertices.
-    // The offsets are relative to `track_position`.
-    // side == distance along `track_normal`
-    // up == distance along kAxisZ3f
-    for (size_t j = 0; j < num_bank_contours; ++j) {
-      flatbuffers::uoffset_t index = static_cast<flatbuffers::uoffset_t>(j);
-      const RiverBankContour* b = (current_zone->banks() != nullptr)
-                                      ? current_zone->banks()->Get(index)
-                                      : river->default_banks()->Get(index);
-      offsets[j] =
-          vec2(mathfu::Lerp(b->x_min(), b->x_max(), mathfu::Random<float>()),
-               mathfu::Lerp(b->z_min(), b->z_max(), mathfu::Random<float>()));
-    }
+// Writes the bank and river vertices for segment `i`. The previous segment
+// must already be generated. Returns true if the vertex positions changed.
+bool RiverMeshJob::GenerateSegment(size_t i) {
+  const size_t num_bank_contours = river->default_banks()->Length();
+  const size_t river_idx = river->river_index();
+  const size_t segment_count = track.size();
 
-    // Create the bank vertices for this segment.
-    for (size_t j = 0; j < num_bank_contours; ++j) {
-      const bool left_bank = j <= river_idx;
-      const vec2 off = offsets[j];
-      const vec3 vertex =
-          track_position +
-          (off.x() + river_width * (left_bank ? -1 : 1)) * track_normal +
-          off.y() * kAxisZ3f;
-      // The texture is stretched from the side of the river to the far end
-      // of the bank. There are two banks, however, separated by the river.
-      // We need to know the width of the bank to caluate the `texture_u`
-      // coordinate.
-      const size_t bank_start = left_bank ? 0 : num_bank_contours - 1;
-      const size_t bank_end = left_bank ? river_idx : river_idx + 1;
-      const float bank_width = offsets[bank_start].x() - offsets[bank_end].x();
-      const float texture_u = (off.x() - offsets[bank_end].x()) / bank_width;
-
-      bank_verts.push_back(NormalMappedColorVertex());
-      bank_verts.back().pos = vec3_packed(vertex);
-      bank_verts.back().tc = vec2_packed(vec2(texture_u, texture_v));
-      bank_verts.back().norm = vec3_packed(vec3(0, 1, 0));
-      bank_verts.back().tangent = vec4_packed(vec4(1, 0, 0, 1));
-      unsigned char color_bytes[4] = {255, 255, 255, within_color_byte};
-      memcpy(bank_verts.back().color, color_bytes, sizeof(color_bytes));
-    }
+  // River track is circular.
+  const size_t prev_i = i == 0 ? segment_count - 1 : i - 1;
+
+  // Get the current position on the track, and the normal (to the side).
+  const vec3 track_delta = vec3(track[i]) - vec3(track[prev_i]);
+  const vec3 track_normal =
+      vec3::CrossProduct(track_delta, kAxisZ3f).Normalized();
+  const vec3 track_position =
+      vec3(track[i]) + river->track_height() * kAxisZ3f;
+
+  // The river texture is tiled several times along the course of the river.
+  // TODO: Change this from tile count to actual physical size for a tile.
+  //       Requires that we know the total path distance.
+  const float texture_v = river->texture_tile_size() * static_cast<float>(i) /
+                          static_cast<float>(segment_count);
+
+  // Fraction of the river we have gone through, approximately.
+  const float fraction =
+      static_cast<float>(i) / static_cast<float>(segment_count);
+
+  // Each zone has its own river width.
+  const unsigned int zone_id = bank_zones[i];
+  const RiverZone* current_zone = river->zones()->Get(zone_id);
+  const float river_width = current_zone->width() != 0
+                                ? current_zone->width()
+                                : river->default_width();
+  float zone_start = zone_id == 0 ? 0 : actual_zone_end[zone_id - 1];
+  float zone_end = actual_zone_end[zone_id];
+  float within_fraction = (fraction - zone_start) / (zone_end - zone_start);
+  if (zone_single_texture[zone_id]) {
+    // Ensure we stay continuous with transitional zones.
+    within_fraction = within_fraction < 0.5f ? 1.0f : 0.0f;
+  }
+
+  int within_color = static_cast<int>(255.0 * within_fraction);
+  // Cap the color to 0..255 byte.
+  unsigned char within_color_byte = static_cast<unsigned char>(
+      within_color < 0 ? 0 : (within_color > 255 ? 255 : within_color));
+
+  // Get the (side, up) offsets of the bank vertices.
+  // The offsets are relative to `track_position`.
+  // side == distance along `track_normal`
+  // up == distance along kAxisZ3f
+  offsets.resize(num_bank_contours);
+  // Each offset has its own pair of random values, so a segment comes out
+  // the same no matter which other segments are generated, or in what order.
+  const RiverRandom random(random_seed);
+  for (size_t j = 0; j < num_bank_contours; ++j) {
+    flatbuffers::uoffset_t index = static_cast<flatbuffers::uoffset_t>(j);
+    const RiverBankContour* b = (current_zone->banks() != nullptr)
+                                    ? current_zone->banks()->Get(index)
+                                    : river->default_banks()->Get(index);
+    const uint32_t counter =
+        static_cast<uint32_t>((i * num_bank_contours + j) * 2);
+    offsets[j] =
+        vec2(mathfu::Lerp(b->x_min(), b->x_max(), random.Get(counter)),
+             mathfu::Lerp(b->z_min(), b->z_max(), random.Get(counter + 1)));
+  }
+
+  // Create the bank vertices for this segment.
+  const NormalMappedColorVertex* prev_verts =
+      &bank_verts[prev_i * num_bank_contours];
+  NormalMappedColorVertex* cur_verts = &bank_verts[i * num_bank_contours];
+  bool positions_changed = false;
+  for (size_t j = 0; j < num_bank_contours; ++j) {
+    const bool left_bank = j <= river_idx;
+    const vec2 off = offsets[j];
+    const vec3 vertex =
+        track_position +
+        (off.x() + river_width * (left_bank ? -1 : 1)) * track_normal +
+        off.y() * kAxisZ3f;
+    // The texture is stretched from the side of the river to the far end
+    // of the bank. There are two banks, however, separated by the river.
+    // We need to know the width of the bank to caluate the `texture_u`
+    // coordinate.
+    const size_t bank_start = left_bank ? 0 : num_bank_contours - 1;
+    const size_t bank_end = left_bank ? river_idx : river_idx + 1;
+    const float bank_width = offsets[bank_start].x() - offsets[bank_end].x();
+    const float texture_u = (off.x() - offsets[bank_end].x()) / bank_width;
 
-    // Ensure vertices don't go behind previous vertices on the inside of
-    // a tight corner.
+    vec3_packed pos(vertex);
     if (i > 0) {
-      const NormalMappedColorVertex* prev_verts =
-          &bank_verts[bank_verts.size() - 2 * num_bank_contours];
-      NormalMappedColorVertex* cur_verts =
-          &bank_verts[bank_verts.size() - num_bank_contours];
-      for (size_t j = 0; j < num_bank_contours; j++) {
-        const vec3 vert_delta =
-            vec3(cur_verts[j].pos) - vec3(prev_verts[j].pos);
-        const float dot = vec3::DotProduct(vert_delta, track_delta);
-        const bool cur_vert_goes_backwards_along_track = dot <= 0.0f;
-        if (cur_vert_goes_backwards_along_track) {
-          cur_verts[j].pos = vec3(prev_verts[j].pos) + 0.000001f * track_delta;
-        }
+      // Ensure vertices don't go behind previous vertices on the inside of
+      // a tight corner.
+      const vec3 vert_delta = vec3(pos) - vec3(prev_verts[j].pos);
+      const float dot = vec3::DotProduct(vert_delta, track_delta);
+      const bool cur_vert_goes_backwards_along_track = dot <= 0.0f;
+      if (cur_vert_goes_backwards_along_track) {
+        pos = vec3(prev_verts[j].pos) + 0.000001f * track_delta;
       }
     }
-
-    // Force the beginning and end to line up in their geometry:
     if (i == segment_count - 1) {
-      for (size_t j = 0; j < num_bank_contours; j++)
-        bank_verts[bank_verts.size() - (8 - j)].pos = bank_verts[j].pos;
+      // Force the beginning and end to line up in their geometry:
+      pos = bank_verts[j].pos;
     }
+    positions_changed |= !SamePosition(pos, cur_verts[j].pos);
 
-    // The river has two of the middle vertices of the bank.
-    // The texture coordinates are different, however.
-    const size_t river_vert = bank_verts.size() - num_bank_contours + river_idx;
-    float normalized_texture_v = i / static_cast<float>(segment_count);
-    river_verts.push_back(NormalMappedVertex());
-    river_verts.back().pos = bank_verts[river_vert].pos;
-    river_verts.back().tc = vec2(0.0f, normalized_texture_v);
-    river_verts.back().norm = bank_verts[river_vert].norm;
-    river_verts.back().tangent = bank_verts[river_vert].tangent;
-
-    river_verts.push_back(NormalMappedVertex());
-    river_verts.back().pos = bank_verts[river_vert + 1].pos;
-    river_verts.back().tc = vec2(1.0f, normalized_texture_v);
-    river_verts.back().norm = bank_verts[river_vert + 1].norm;
-    river_verts.back().tangent = bank_verts[river_vert + 1].tangent;
-  }
-
-  // Not counting the first segment, create triangles in our index
-  // list to represent this segment.
-  //
-  for (size_t i = 0; i < segment_count - 1; i++) {
-    auto make_quad = [&](std::vector<unsigned short>& indices, int base_index,
-                         int off1, int off2) {
-      indices.push_back(static_cast<unsigned short>(base_index + off1));
-      indices.push_back(static_cast<unsigned short>(base_index + off1 + 1));
-      indices.push_back(static_cast<unsigned short>(base_index + off2));
+    NormalMappedColorVertex& v = cur_verts[j];
+    v.pos = pos;
+    v.tc = vec2_packed(vec2(texture_u, texture_v));
+    v.norm = vec3_packed(vec3(0, 1, 0));
+    v.tangent = vec4_packed(vec4(1, 0, 0, 1));
+    unsigned char color_bytes[4] = {255, 255, 255, within_color_byte};
+    memcpy(v.color, color_bytes, sizeof(color_bytes));
+  }
+
+  // The river has two of the middle vertices of the bank.
+  // The texture coordinates are different, however.
+  float normalized_texture_v = i / static_cast<float>(segment_count);
+  NormalMappedVertex* river_vert = &river_verts[2 * i];
+  river_vert[0].pos = cur_verts[river_idx].pos;
+  river_vert[0].tc = vec2(0.0f, normalized_texture_v);
+  river_vert[0].norm = vec3(0, 1, 0);
+  river_vert[0].tangent = vec4(1, 0, 0, 1);
+
+  river_vert[1].pos = cur_verts[river_idx + 1].pos;
+  river_vert[1].tc = vec2(1.0f, normalized_texture_v);
+  river_vert[1].norm = vec3(0, 1, 0);
+  river_vert[1].tangent = vec4(1, 0, 0, 1);
+  return positions_changed;
+}
+
+// Adds the two triangles of the quad between the vertices at `off1` and
+// `off2` and the ones after them.
+template <typename Index>
+static void MakeQuad(size_t base_index, size_t off1, size_t off2,
+                     std::vector<Index>* indices) {
+  indices->push_back(static_cast<Index>(base_index + off1));
+  indices->push_back(static_cast<Index>(base_index + off1 + 1));
+  indices->push_back(static_cast<Index>(base_index + off2));
+
+  indices->push_back(static_cast<Index>(base_index + off2));
+  indices->push_back(static_cast<Index>(base_index + off1 + 1));
+  indices->push_back(static_cast<Index>(base_index + off2 + 1));
+}
+
+// Not counting the first segment, create triangles in our index
+// list to represent each segment. Indices only depend on the number of
+// segments and the zones, so they don't change when the track moves.
+void RiverMeshJob::GenerateIndices() {
+  const size_t num_bank_contours = river->default_banks()->Length();
+  const size_t num_bank_quads = num_bank_contours - 2;
+  const size_t river_idx = river->river_index();
+  const size_t segment_count = track.size();
+  // Chunks are kept short enough for their 16-bit indices, however long the
+  // river is.
+  const size_t chunk_segments = std::min(
+      static_cast<size_t>(std::max(river->chunk_segments(), 1)),
+      kMaxIndexedVertices / num_bank_contours - 1);
+
+  bank_indices.clear();
+  bank_indices.reserve((segment_count - 1) * kNumIndicesPerQuad *
+                       num_bank_quads);
+  // Use one set of bank vertices for the entire riverbank, but separate out
+  // the chunks and zones via indices, so we can cull the chunks and use
+  // different materials (and possibly shaders) per zone. We still keep
+  // bank_indices for the normal calculation, though.
+  river_pieces.clear();
+  bank_pieces.clear();
 
-      indices.push_back(static_cast<unsigned short>(base_index + off2));
-      indices.push_back(static_cast<unsigned short>(base_index + off1 + 1));
-      indices.push_back(static_cast<unsigned short>(base_index + off2 + 1));
-    };
+  for (size_t i = 0; i < segment_count - 1; i++) {
+    // Start new pieces at the start of each chunk, and, for the banks, at
+    // the start of each zone. A piece's vertices run from its first segment
+    // to the one after its last.
+    const unsigned int zone = bank_zones[i];
+    const bool chunk_start = i % chunk_segments == 0;
+    if (chunk_start) {
+      river_pieces.push_back(RiverMeshPiece());
+      river_pieces.back().vert_begin = 2 * i;
+    }
+    if (chunk_start || zone != bank_zones[i - 1]) {
+      bank_pieces.push_back(RiverMeshPiece());
+      bank_pieces.back().vert_begin = i * num_bank_contours;
+      bank_pieces.back().zone = zone;
+    }
+    RiverMeshPiece& river_piece = river_pieces.back();
+    RiverMeshPiece& bank_piece = bank_pieces.back();
+    river_piece.vert_end = 2 * (i + 2);
+    bank_piece.vert_end = (i + 2) * num_bank_contours;
 
     // River only has one quad per segment.
-    make_quad(river_indices, 2 * static_cast<int>(i), 0, 2);
+    MakeQuad(2 * i - river_piece.vert_begin, 0, 2, &river_piece.indices);
 
     // Case when kNumBankCountours = 8, and river_idx = 3;
     //
@@ -382,103 +777,294 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
     for (size_t j = 0; j <= num_bank_quads; ++j) {
       // Do not create bank geo for the river.
       if (j == river_idx) continue;
-      unsigned int zone = bank_zones[i];
-      int base_index = static_cast<int>(i * num_bank_contours);
-      int offset1 = static_cast<int>(j);
-      int offset2 = static_cast<int>(num_bank_contours + j);
-      make_quad(bank_indices, base_index, offset1, offset2);
-      make_quad(bank_indices_by_zone[zone], base_index, offset1, offset2);
-
-      // Add the same triangles to the static mesh associated with the entity.
-      physics_component->AddStaticMeshTriangle(
-          entity, vec3(bank_verts[base_index + offset1].pos),
-          vec3(bank_verts[base_index + offset1 + 1].pos),
-          vec3(bank_verts[base_index + offset2].pos));
-
-      physics_component->AddStaticMeshTriangle(
-          entity, vec3(bank_verts[base_index + offset2].pos),
-          vec3(bank_verts[base_index + offset1 + 1].pos),
-          vec3(bank_verts[base_index + offset2 + 1].pos));
+      const size_t base_index = i * num_bank_contours;
+      const size_t offset1 = j;
+      const size_t offset2 = num_bank_contours + j;
+      MakeQuad(base_index, offset1, offset2, &bank_indices);
+      MakeQuad(base_index - bank_piece.vert_begin, offset1, offset2,
+               &bank_piece.indices);
     }
   }
 
   // Make sure we used as much data as expected, and no more.
-  assert(river_indices.size() == river_index_max);
-  assert(river_verts.size() == river_vert_max);
-  assert(bank_indices.size() == bank_index_max);
-  assert(bank_verts.size() == bank_vert_max);
+  assert(bank_indices.size() ==
+         (segment_count - 1) * kNumIndicesPerQuad * num_bank_quads);
+}
 
-  Mesh::ComputeNormalsTangents(bank_verts.data(), bank_indices.data(),
-                               static_cast<int>(bank_verts.size()),
-                               static_cast<int>(bank_indices.size()));
+// Recomputes the normals and tangents of the bank vertices of segments
+// [begin, end). The triangles around those vertices reach one segment further
+// on each side, so the computation runs on a copy of that wider window. Long
+// ranges are split into windows small enough for 16-bit indices.
+void RiverMeshJob::ComputeNormals(size_t begin, size_t end) {
+  const size_t num_bank_contours = river->default_banks()->Length();
+  const size_t num_bank_quads = num_bank_contours - 2;
+  const size_t num_indices = kNumIndicesPerQuad * num_bank_quads;
+  const size_t segment_count = track.size();
+  const size_t max_segments = kMaxIndexedVertices / num_bank_contours - 2;
 
-  // Load the material from files.
-  Material* river_material =
-      asset_manager->LoadMaterial(river->material()->c_str());
-  // Create the actual mesh objects, and stuff all the data we just
-  // generated into it.
-  Mesh* river_mesh =
-      new Mesh(river_verts.data(), static_cast<int>(river_verts.size()),
-               static_cast<int>(sizeof(NormalMappedVertex)), kMeshFormat);
+  for (size_t block_begin = begin; block_begin < end;
+       block_begin += max_segments) {
+    const size_t block_end = std::min(block_begin + max_segments, end);
+    const size_t window_begin = block_begin == 0 ? 0 : block_begin - 1;
+    const size_t window_end = std::min(block_end + 1, segment_count);
+
+    window_verts.assign(bank_verts.begin() + window_begin * num_bank_contours,
+                        bank_verts.begin() + window_end * num_bank_contours);
+    window_indices.clear();
+    const size_t base_index = window_begin * num_bank_contours;
+    for (size_t i = window_begin; i + 1 < window_end; ++i) {
+      const uint32_t* indices = &bank_indices[i * num_indices];
+      for (size_t k = 0; k < num_indices; ++k) {
+        window_indices.push_back(
+            static_cast<unsigned short>(indices[k] - base_index));
+      }
+    }
+    Mesh::ComputeNormalsTangents(window_verts.data(), window_indices.data(),
+                                 static_cast<int>(window_verts.size()),
+                                 static_cast<int>(window_indices.size()));
+
+    for (size_t v = block_begin * num_bank_contours;
+         v < block_end * num_bank_contours; ++v) {
+      const NormalMappedColorVertex& window_vert = window_verts[v - base_index];
+      bank_verts[v].norm = window_vert.norm;
+      bank_verts[v].tangent = window_vert.tangent;
+    }
+  }
+}
+
+// Sets the origin and bounds of each of `pieces` from its slice of `verts`,
+// and writes the slice to `upload_verts` relative to the origin.
+template <typename Vertex, typename UploadVertex>
+static void PackPieceVerts(const std::vector<Vertex>& verts,
+                           std::vector<RiverMeshPiece>* pieces,
+                           std::vector<UploadVertex>* upload_verts,
+                           void (*pack)(const Vertex&, const vec3&,
+                                        UploadVertex*)) {
+  upload_verts->clear();
+  for (auto piece = pieces->begin(); piece != pieces->end(); ++piece) {
+    vec3 min_position = vec3(verts[piece->vert_begin].pos);
+    vec3 max_position = min_position;
+    for (size_t v = piece->vert_begin + 1; v < piece->vert_end; ++v) {
+      const vec3 pos(verts[v].pos);
+      min_position = vec3::Min(min_position, pos);
+      max_position = vec3::Max(max_position, pos);
+    }
+    const vec3 origin = (min_position + max_position) * 0.5f;
+    piece->origin = origin;
+    piece->min_position = min_position - origin;
+    piece->max_position = max_position - origin;
+
+    piece->upload_begin = upload_verts->size();
+    upload_verts->resize(upload_verts->size() + piece->vert_end -
+                         piece->vert_begin);
+    UploadVertex* upload = &(*upload_verts)[piece->upload_begin];
+    for (size_t v = piece->vert_begin; v < piece->vert_end; ++v) {
+      pack(verts[v], origin, upload++);
+    }
+  }
+}
+
+static void PackRiverVertex(const NormalMappedVertex& vert,
+                            const vec3& origin, RiverVertex* packed) {
+  packed->pos = vec3(vert.pos) - origin;
+  packed->tc = vert.tc;
+}
+
+static void PackBankVertex(const NormalMappedColorVertex& vert,
+                           const vec3& origin, BankVertex* packed) {
+  packed->pos = vec3(vert.pos) - origin;
+  packed->tc = vert.tc;
+  packed->norm = vert.norm;
+  memcpy(packed->color, vert.color, sizeof(packed->color));
+}
 
-  river_mesh->AddIndices(river_indices.data(),
-                         static_cast<int>(river_indices.size()),
-                         river_material);
+void RiverMeshJob::PackPieces() {
+  PackPieceVerts(river_verts, &river_pieces, &river_upload_verts,
+                 PackRiverVertex);
+  PackPieceVerts(bank_verts, &bank_pieces, &bank_upload_verts,
+                 PackBankVertex);
+}
 
-  // Add the river mesh to the river entity.
+// Replaces the mesh of `chunk` with `mesh`, and takes the origin and bounds
+// of `piece`. `river_transform` is the world transform of the river entity.
+static void SetChunkMesh(const RiverMeshPiece& piece, Mesh* mesh,
+                         fplbase::Shader* shader, RenderMeshData* render_data,
+                         TransformData* transform_data,
+                         const mat4& river_transform, RiverChunk* chunk) {
+  if (render_data->mesh != nullptr) {
+    // Mesh's destructor handles cleaning up its GL buffers
+    delete render_data->mesh;
+    render_data->mesh = nullptr;
+  }
+  render_data->mesh = mesh;
+  render_data->shader = shader;
+  // The river component culls the chunks itself, using their bounds.
+  render_data->culling_mask = 0;
+  render_data->pass_mask = 1 << corgi::RenderPass_Opaque;
+  transform_data->position = vec3(piece.origin);
+  // The transform component has already updated the world transforms this
+  // frame, so the chunk would otherwise draw at its old origin for a frame.
+  transform_data->world_transform =
+      river_transform * transform_data->GetTransformMatrix();
+  chunk->min_position = piece.min_position;
+  chunk->max_position = piece.max_position;
+}
+
+// Uploads the mesh generated by the worker thread to the GPU, split into
+// chunks held by children of this entity. The old meshes are only deleted
+// once their replacements exist.
+void RiverComponent::UploadRiverMesh(corgi::EntityRef& entity) {
+  static const fplbase::Attribute kMeshFormat[] = {
+      fplbase::kPosition3f, fplbase::kTexCoord2f, fplbase::kEND};
+  static const fplbase::Attribute kBankMeshFormat[] = {
+      fplbase::kPosition3f, fplbase::kTexCoord2f, fplbase::kNormal3f,
+      fplbase::kColor4ub, fplbase::kEND};
+  RiverData* river_data = Data<RiverData>(entity);
+  const RiverMeshJob* job = river_data->mesh_job.get();
+  const RiverConfig* river = job->river;
+  const unsigned int num_zones = river->zones()->Length();
+
+  fplbase::AssetManager* asset_manager =
+      entity_manager_->GetComponent<ServicesComponent>()->asset_manager();
+
+  const mat4 river_transform = Data<TransformData>(entity)->world_transform;
+
+  // The river entity itself doesn't draw anything, its chunks do.
   RenderMeshData* mesh_data = Data<RenderMeshData>(entity);
-  mesh_data->shader = asset_manager->LoadShader(river->shader()->c_str());
   if (mesh_data->mesh != nullptr) {
-    // Mesh's destructor handles cleaning up its GL buffers
     delete mesh_data->mesh;
     mesh_data->mesh = nullptr;
   }
-  mesh_data->mesh = river_mesh;
-  mesh_data->culling_mask = 0;  // Never cull the river.
-  mesh_data->pass_mask = 1 << corgi::RenderPass_Opaque;
+  mesh_data->pass_mask = 0;
 
-  river_data->banks.resize(num_zones, corgi::EntityRef());
-  for (unsigned int zone = 0; zone < num_zones; zone++) {
+  // Load the material from files.
+  Material* river_material =
+      asset_manager->LoadMaterial(river->material()->c_str());
+  fplbase::Shader* river_shader =
+      asset_manager->LoadShader(river->shader()->c_str());
+  // Create the actual mesh objects, and stuff all the data we just
+  // generated into them.
+  ResizeChunks(entity, job->river_pieces.size(), &river_data->water_chunks);
+  for (size_t i = 0; i < job->river_pieces.size(); i++) {
+    const RiverMeshPiece& piece = job->river_pieces[i];
+    Mesh* river_mesh =
+        new Mesh(&job->river_upload_verts[piece.upload_begin],
+                 static_cast<int>(piece.vert_end - piece.vert_begin),
+                 static_cast<int>(sizeof(RiverVertex)), kMeshFormat);
+    river_mesh->AddIndices(piece.indices.data(),
+                           static_cast<int>(piece.indices.size()),
+                           river_material);
+    RiverChunk* chunk = &river_data->water_chunks[i];
+    SetChunkMesh(piece, river_mesh, river_shader,
+                 Data<RenderMeshData>(chunk->entity),
+                 Data<TransformData>(chunk->entity), river_transform, chunk);
+  }
+
+  ResizeChunks(entity, job->bank_pieces.size(), &river_data->bank_chunks);
+  for (size_t i = 0; i < job->bank_pieces.size(); i++) {
+    const RiverMeshPiece& piece = job->bank_pieces[i];
     Material* bank_material = asset_manager->LoadMaterial(
-        river->zones()->Get(zone)->material()->c_str());
+        river->zones()->Get(piece.zone)->material()->c_str());
+    fplbase::Shader* bank_shader =
+        asset_manager->LoadShader(job->zone_single_texture[piece.zone]
+                                      ? "shaders/textured_lit"
+                                      : "shaders/textured_lit_bank");
 
+    // Each chunk only uploads the vertices its triangles use.
     Mesh* bank_mesh =
-        new Mesh(bank_verts.data(), static_cast<int>(bank_verts.size()),
-                 sizeof(NormalMappedColorVertex), kBankMeshFormat);
-
-    bank_mesh->AddIndices(bank_indices_by_zone[zone].data(),
-                          static_cast<int>(bank_indices_by_zone[zone].size()),
+        new Mesh(&job->bank_upload_verts[piece.upload_begin],
+                 static_cast<int>(piece.vert_end - piece.vert_begin),
+                 sizeof(BankVertex), kBankMeshFormat);
+    bank_mesh->AddIndices(piece.indices.data(),
+                          static_cast<int>(piece.indices.size()),
                           bank_material);
-    if (!river_data->banks[zone]) {
-      // Now we make a new entity to hold the bank mesh.
-      river_data->banks[zone] = entity_manager_->AllocateNewEntity();
-      entity_manager_->AddEntityToComponent<RenderMeshComponent>(
-          river_data->banks[zone]);
-
-      // Then we stick it as a child of the river entity, so it always moves
-      // with it and stays aligned:
-      auto transform_component =
-          GetComponent<corgi::component_library::TransformComponent>();
-      transform_component->AddChild(river_data->banks[zone], entity);
-    }
+    RiverChunk* chunk = &river_data->bank_chunks[i];
+    SetChunkMesh(piece, bank_mesh, bank_shader,
+                 Data<RenderMeshData>(chunk->entity),
+                 Data<TransformData>(chunk->entity), river_transform, chunk);
+  }
 
-    RenderMeshData* child_render_data =
-        Data<RenderMeshData>(river_data->banks[zone]);
-    if (bank_material->textures().size() == 1) {
-      child_render_data->shader =
-          asset_manager->LoadShader("shaders/textured_lit");
-    } else {
-      child_render_data->shader =
-          asset_manager->LoadShader("shaders/textured_lit_bank");
-    }
-    if (child_render_data->mesh != nullptr) {
-      // Mesh's destructor handles cleaning up its GL buffers
-      delete child_render_data->mesh;
-      child_render_data->mesh = nullptr;
+  // Compare with every zone holding all the full-size bank vertices, and one
+  // full-size water mesh.
+  fplbase::LogInfo(
+      "River: %d bytes of vertices in %d chunks, instead of %d bytes.",
+      static_cast<int>(job->river_upload_verts.size() * sizeof(RiverVertex) +
+                       job->bank_upload_verts.size() * sizeof(BankVertex)),
+      static_cast<int>(job->river_pieces.size() + job->bank_pieces.size()),
+      static_cast<int>(num_zones * job->bank_verts.size() *
+                           sizeof(NormalMappedColorVertex) +
+                       job->river_verts.size() * sizeof(NormalMappedVertex)));
+}
+
+// Makes `chunks` hold `count` child entities of `entity`, each with a render
+// mesh. Extra chunks are deleted along with their meshes.
+void RiverComponent::ResizeChunks(corgi::EntityRef& entity, size_t count,
+                                  std::vector<RiverChunk>* chunks) {
+  while (chunks->size() > count) {
+    RenderMeshData* render_data = Data<RenderMeshData>(chunks->back().entity);
+    delete render_data->mesh;
+    render_data->mesh = nullptr;
+    entity_manager_->DeleteEntity(chunks->back().entity);
+    chunks->pop_back();
+  }
+  while (chunks->size() < count) {
+    // Now we make a new entity to hold the chunk's mesh.
+    RiverChunk chunk;
+    chunk.entity = entity_manager_->AllocateNewEntity();
+    entity_manager_->AddEntityToComponent<RenderMeshComponent>(chunk.entity);
+
+    // Then we stick it as a child of the river entity, so it always moves
+    // with it and stays aligned:
+    auto transform_component =
+        GetComponent<corgi::component_library::TransformComponent>();
+    transform_component->AddChild(chunk.entity, entity);
+    chunks->push_back(chunk);
+  }
+}
+
+// Hide the chunks whose bounds are outside the camera's view, and show the
+// others.
+void RiverComponent::CullChunks(const corgi::CameraInterface& camera) {
+  const Frustum frustum(camera.GetTransformMatrix());
+  int num_visible = 0;
+  int num_chunks = 0;
+  auto cull = [&](std::vector<RiverChunk>& chunks) {
+    for (auto chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+      RenderMeshData* render_data = Data<RenderMeshData>(chunk->entity);
+      const TransformData* transform_data = Data<TransformData>(chunk->entity);
+      render_data->visible = frustum.IntersectsBox(
+          transform_data->world_transform, vec3(chunk->min_position),
+          vec3(chunk->max_position));
+      num_visible += render_data->visible ? 1 : 0;
+      num_chunks++;
     }
-    child_render_data->mesh = bank_mesh;
-    child_render_data->culling_mask = 0;  // Don't cull the banks for now.
-    child_render_data->pass_mask = 1 << corgi::RenderPass_Opaque;
+  };
+  for (auto iter = begin(); iter != end(); ++iter) {
+    RiverData* river_data = Data<RiverData>(iter->entity);
+    cull(river_data->water_chunks);
+    cull(river_data->bank_chunks);
+  }
+  TraceCounter("RiverChunksDrawn", num_visible);
+  TraceCounter("RiverChunksCulled", num_chunks - num_visible);
+}
+
+// Replace the static physics mesh around the river bank with the one from the
+// finished job. The physics mesh is built straight from the bank's shared
+// vertices and indices, rather than from a copy of each triangle.
+void RiverComponent::CreateRiverPhysics(corgi::EntityRef& entity) {
+  const RiverMeshJob* job = Data<RiverData>(entity)->mesh_job.get();
+  const RiverConfig* river = job->river;
+  const Uint64 start = SDL_GetPerformanceCounter();
+
+  // Create the static physics mesh around the river bank.
+  auto* physics_component = entity_manager_->GetComponent<PhysicsComponent>();
+  physics_component->InitStaticMesh(entity);
+  const std::vector<NormalMappedColorVertex>& verts = job->bank_verts;
+  const std::vector<uint32_t>& indices = job->bank_indices;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    physics_component->AddStaticMeshTriangle(
+        entity, vec3(verts[indices[i]].pos), vec3(verts[indices[i + 1]].pos),
+        vec3(verts[indices[i + 2]].pos));
   }
 
   // Finalize the static physics mesh created on the river bank.
@@ -494,18 +1080,29 @@ void RiverComponent::CreateRiverMesh(corgi::EntityRef& entity) {
   physics_component->FinalizeStaticMesh(entity, collision_type, collides_with,
                                         river->mass(), river->restitution(),
                                         user_tag);
+
+  // Compare the shared vertices and indices with the copy of every triangle's
+  // vertices that the physics mesh used to be built from.
+  const double milliseconds =
+      1000.0 * static_cast<double>(SDL_GetPerformanceCounter() - start) /
+      static_cast<double>(SDL_GetPerformanceFrequency());
+  fplbase::LogInfo(
+      "River physics (%s): %d triangles in %.2f ms, from %d bytes of shared "
+      "vertices and indices instead of %d bytes of triangle vertices.",
+      job->changed_all ? "rebuild" : "edit",
+      static_cast<int>(indices.size() / 3), milliseconds,
+      static_cast<int>(verts.size() * sizeof(vec3_packed) +
+                       indices.size() * sizeof(uint32_t)),
+      static_cast<int>(indices.size() * sizeof(vec3_packed)));
 }
 
 void RiverComponent::UpdateRiverMeshes(corgi::EntityRef entity) {
+  // Editing a rail node only affects the rivers on that rail. Any other
+  // entity could be the parent of rail nodes, so check all the rivers. Rivers
+  // whose track didn't move don't get regenerated.
   const RailNodeData* node_data =
       entity_manager_->GetComponentData<RailNodeData>(entity);
-  if (node_data != nullptr) {
-    // For now, update all rivers. In the future only update rivers that
-    // have the same rail_name that just changed.
-    for (auto iter = begin(); iter != end(); ++iter) {
-      CreateRiverMesh(iter->entity);
-    }
-  }
+  TriggerRiverUpdate(node_data != nullptr ? &node_data->rail_name : nullptr);
 }
 
 }  // zooshi
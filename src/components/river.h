@@ -15,10 +15,12 @@
 #ifndef COMPONENTS_RIVER_H
 #define COMPONENTS_RIVER_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "components_generated.h"
 #include "corgi/component.h"
+#include "corgi_component_library/camera_interface.h"
 #include "fplbase/mesh.h"
 #include "mathfu/constants.h"
 #include "mathfu/glsl_mappings.h"
@@ -28,6 +30,17 @@
 namespace fpl {
 namespace zooshi {
 
+struct RiverMeshJob;
+class RiverMeshWorker;
+
+// A piece of a river's render mesh, covering a few segments of the track.
+// The bounds are in the river entity's space.
+struct RiverChunk {
+  corgi::EntityRef entity;
+  mathfu::vec3_packed min_position;
+  mathfu::vec3_packed max_position;
+};
+
 // All the relevent data for rivers ends up tossed into other components.
 // (Mostly rendermesh at the moment.)  This will probably be less empty
 // once the river gets more animated.
@@ -35,18 +48,24 @@ struct RiverData {
   RiverData()
       : render_mesh_needs_update_(false),
         random_seed(static_cast<unsigned int>(rand())) {}
-  std::vector<corgi::EntityRef> banks;
+  // Child entities holding the chunks of the water and bank meshes. A bank
+  // chunk also ends where a zone ends, since zones have their own materials.
+  std::vector<RiverChunk> water_chunks;
+  std::vector<RiverChunk> bank_chunks;
   std::string rail_name;
   // Flag for whether this river needs its meshes updated.
   bool render_mesh_needs_update_;
   // River generation has random elements, so we seed the random number
   // generator the same way every time we reload the river.
   unsigned int random_seed;
+  // Buffers used to generate the meshes in the background.
+  std::shared_ptr<RiverMeshJob> mesh_job;
 };
 
 class RiverComponent : public corgi::Component<RiverData> {
  public:
-  virtual ~RiverComponent() {}
+  RiverComponent();
+  virtual ~RiverComponent();
 
   virtual void AddFromRawData(corgi::EntityRef& entity, const void* raw_data);
   virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
@@ -54,20 +73,44 @@ class RiverComponent : public corgi::Component<RiverData> {
   virtual void Init();
   virtual void UpdateAllEntities(corgi::WorldTime /*delta_time*/);
 
+  // Request an update of the rivers affected by a change to `entity`.
   void UpdateRiverMeshes(corgi::EntityRef entity);
 
-  // Updates the meshes for the river.
+  // Updates the meshes for the river. Meshes are generated on a worker thread
+  // and swapped in by a later call once they're ready, so the old mesh stays
+  // on screen in the meantime.
   // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
   // IMPORTANT:  This will break if called from any thread other than
   // the main render thread.  Do not call from the update thread!
   void UpdateRiverMeshes();
 
+  // Block until the meshes being generated are ready, and swap them in.
+  void FinishRiverMeshes();
+
+  // Hide the chunks of the rivers that `camera` can't see. Call before the
+  // render mesh component's RenderPrep().
+  void CullChunks(const corgi::CameraInterface& camera);
+
   float river_offset() const { return river_offset_; }
 
+  // When false, only the physics of the river banks are created, so the
+  // rivers can be updated without an OpenGL context.
+  void set_create_render_meshes(bool create_render_meshes) {
+    create_render_meshes_ = create_render_meshes;
+  }
+
  private:
-  void TriggerRiverUpdate();
-  void CreateRiverMesh(corgi::EntityRef& entity);
+  void TriggerRiverUpdate(const std::string* rail_name);
+  void StartRiverMesh(corgi::EntityRef& entity);
+  void SwapInRiverMesh(corgi::EntityRef& entity);
+  void UploadRiverMesh(corgi::EntityRef& entity);
+  void ResizeChunks(corgi::EntityRef& entity, size_t count,
+                    std::vector<RiverChunk>* chunks);
+  void CreateRiverPhysics(corgi::EntityRef& entity);
   float river_offset_;
+  bool create_render_meshes_;
+  // Thread that generates the meshes of every river, started with the first.
+  std::unique_ptr<RiverMeshWorker> mesh_worker_;
 };
 
 }  // zooshi
@@ -14,6 +14,8 @@
 
 #include "components/scenery.h"
 
+#include <algorithm>
+#include <iterator>
 #include <vector>
 #include "components/services.h"
 #include "components_generated.h"
@@ -36,10 +38,13 @@ using corgi::component_library::TransformData;
 using corgi::EntityRef;
 using scene_lab::SceneLab;
 using mathfu::vec3;
-using mathfu::kZeros3f;
 
 void SceneryComponent::Init() {
   config_ = entity_manager_->GetComponent<ServicesComponent>()->config();
+  auto render_config = config_->rendering_config();
+  pop_in_distance_ = render_config->pop_in_distance();
+  pop_out_distance_ = render_config->pop_out_distance();
+  scenery_grid_ = SpatialGrid(pop_in_distance_);
 
   // Scene Lab is not guaranteed to be present in all versions of the game.
   // Only set up callbacks if we actually have a Scene Lab.
@@ -51,11 +56,21 @@ void SceneryComponent::Init() {
   }
 }
 
+void SceneryComponent::SetPopDistances(float pop_in_distance,
+                                       float pop_out_distance) {
+  pop_in_distance_ = pop_in_distance;
+  pop_out_distance_ = pop_out_distance;
+  // The grid's cells are as large as the pop in distance.
+  scenery_grid_ = SpatialGrid(pop_in_distance_);
+  scenery_grid_dirty_ = true;
+}
+
 void SceneryComponent::AddFromRawData(corgi::EntityRef& scenery,
                                       const void* raw_data) {
   auto scenery_def = static_cast<const SceneryDef*>(raw_data);
   SceneryData* scenery_data = AddEntity(scenery);
   scenery_data->anim_object = scenery_def->anim_object();
+  scenery_grid_dirty_ = true;
 }
 
 corgi::ComponentInterface::RawDataUniquePtr SceneryComponent::ExportRawData(
@@ -65,6 +80,10 @@ corgi::ComponentInterface::RawDataUniquePtr SceneryComponent::ExportRawData(
 
 void SceneryComponent::InitEntity(corgi::EntityRef& /*scenery*/) {}
 
+void SceneryComponent::CleanupEntity(corgi::EntityRef& /*scenery*/) {
+  scenery_grid_dirty_ = true;
+}
+
 void SceneryComponent::PostLoadFixup() {
   const TransformComponent* transform_component =
       entity_manager_->GetComponent<TransformComponent>();
@@ -87,6 +106,7 @@ void SceneryComponent::PostLoadFixup() {
     AnimationData* animation_data =
         Data<AnimationData>(scenery_data->render_child);
     animation_data->anim_table_object = scenery_data->anim_object;
+    scenery_data->disappear_time = AnimLength(scenery_data, kSceneryDisappear);
 
     // Everything starts off-screen.
     scenery_data->state = kSceneryHide;
@@ -94,6 +114,30 @@ void SceneryComponent::PostLoadFixup() {
     // Ensure all scenery starts hidden.
     Show(scenery, false);
   }
+  scenery_grid_dirty_ = true;
+}
+
+// Add every scenery entity to the grid, at its current position. Scenery
+// doesn't move outside of Scene Lab, which calls PostLoadFixup() on exit.
+void SceneryComponent::UpdateSceneryGrid() {
+  scenery_entities_.clear();
+  visible_scenery_.clear();
+  scenery_grid_.Clear();
+  max_disappear_time_ = 0.0f;
+  for (auto iter = component_data_.begin(); iter != component_data_.end();
+       ++iter) {
+    const int index = static_cast<int>(scenery_entities_.size());
+    const TransformData* transform_data = Data<TransformData>(iter->entity);
+    scenery_entities_.push_back(iter->entity);
+    scenery_grid_.Add(transform_data->position, index);
+    if (iter->data.state != kSceneryHide) {
+      visible_scenery_.push_back(index);
+    }
+    max_disappear_time_ =
+        std::max(max_disappear_time_, iter->data.disappear_time);
+  }
+  scenery_grid_.Finalize();
+  scenery_grid_dirty_ = false;
 }
 
 const RailDenizenData& SceneryComponent::Raft() const {
@@ -105,24 +149,19 @@ const RailDenizenData& SceneryComponent::Raft() const {
 }
 
 float SceneryComponent::PopInDistSq() const {
-  auto render_config = config_->rendering_config();
-  const float dist = render_config->pop_in_distance();
-  return dist * dist;
+  return pop_in_distance_ * pop_in_distance_;
 }
 
 float SceneryComponent::PopOutDistSq() const {
-  auto render_config = config_->rendering_config();
-  const float dist = render_config->pop_out_distance();
-  return dist * dist;
+  return pop_out_distance_ * pop_out_distance_;
 }
 
 float SceneryComponent::DistSq(const corgi::EntityRef& scenery,
                                const RailDenizenData& raft) const {
   const SceneryData* scenery_data = Data<SceneryData>(scenery);
   const TransformData* transform_data = Data<TransformData>(scenery);
-  const float disappear_time = AnimLength(scenery_data, kSceneryDisappear);
   const vec3 pop_out_position =
-      raft.Position() + raft.Velocity() * static_cast<float>(disappear_time);
+      raft.Position() + raft.Velocity() * scenery_data->disappear_time;
   return (transform_data->position - pop_out_position).LengthSquared();
 }
 
@@ -289,10 +328,27 @@ void SceneryComponent::ApplyShowOverride(const corgi::EntityRef& scenery,
 }
 
 void SceneryComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
+  if (scenery_grid_dirty_) {
+    UpdateSceneryGrid();
+  }
   const RailDenizenData& raft = Raft();
-  for (auto iter = component_data_.begin(); iter != component_data_.end();
-       ++iter) {
-    corgi::EntityRef scenery = iter->entity;
+
+  // Hidden scenery only appears when it's within the pop-in distance of the
+  // raft's predicted position, which is at most `max_disappear_time_` ahead of
+  // the raft.
+  const float query_radius =
+      pop_in_distance_ + raft.Velocity().Length() * max_disappear_time_;
+  scenery_grid_.Query(raft.Position(), query_radius, &nearby_scenery_);
+
+  // Visit the scenery that isn't hidden, and the hidden scenery near the raft.
+  scenery_to_update_.clear();
+  std::set_union(visible_scenery_.begin(), visible_scenery_.end(),
+                 nearby_scenery_.begin(), nearby_scenery_.end(),
+                 std::back_inserter(scenery_to_update_));
+  visible_scenery_.clear();
+  for (auto it = scenery_to_update_.begin(); it != scenery_to_update_.end();
+       ++it) {
+    corgi::EntityRef scenery = scenery_entities_[*it];
     const SceneryData* scenery_data = Data<SceneryData>(scenery);
 
     // Execute state machine for each piece of scenery.
@@ -300,6 +356,9 @@ void SceneryComponent::UpdateAllEntities(corgi::WorldTime /*delta_time*/) {
     if (scenery_data->state != next_state) {
       TransitionState(scenery, next_state);
     }
+    if (scenery_data->state != kSceneryHide) {
+      visible_scenery_.push_back(*it);
+    }
   }
 }
 
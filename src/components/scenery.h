@@ -15,10 +15,12 @@
 #ifndef COMPONENTS_SCENERY_H_
 #define COMPONENTS_SCENERY_H_
 
+#include <vector>
 #include "components/rail_denizen.h"
 #include "config_generated.h"
 #include "corgi/component.h"
 #include "mathfu/glsl_mappings.h"
+#include "spatial_grid.h"
 
 namespace fpl {
 namespace zooshi {
@@ -33,7 +35,10 @@ enum SceneryState {
 
 // Data for scene object components.
 struct SceneryData {
-  SceneryData() : state(kSceneryHide), show_override(kSceneryInvalid) {}
+  SceneryData()
+      : state(kSceneryHide),
+        show_override(kSceneryInvalid),
+        disappear_time(0.0f) {}
 
   // The child of the scenery entity that has a RenderMeshComponent and
   // an AnimationComponent.
@@ -49,17 +54,27 @@ struct SceneryData {
   // the show state. The scenery override is reset when the scenery object
   // disappears.
   SceneryState show_override;
+
+  // Length of the disappear animation. Cached by PostLoadFixup().
+  float disappear_time;
 };
 
 class SceneryComponent : public corgi::Component<SceneryData> {
  public:
-  SceneryComponent() {}
+  SceneryComponent()
+      : config_(nullptr),
+        scenery_grid_(1.0f),
+        pop_in_distance_(0.0f),
+        pop_out_distance_(0.0f),
+        max_disappear_time_(0.0f),
+        scenery_grid_dirty_(true) {}
   virtual ~SceneryComponent() {}
 
   virtual void Init();
   virtual void AddFromRawData(corgi::EntityRef& parent, const void* raw_data);
   virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
   virtual void InitEntity(corgi::EntityRef& entity);
+  virtual void CleanupEntity(corgi::EntityRef& entity);
   virtual void UpdateAllEntities(corgi::WorldTime delta_time);
 
   // This needs to be called after the entities have been loaded from data.
@@ -70,6 +85,10 @@ class SceneryComponent : public corgi::Component<SceneryData> {
   void ApplyShowOverride(const corgi::EntityRef& scenery,
                          SceneryState show_override);
 
+  // Change the distances at which scenery pops in and out. They start out as
+  // set in the rendering config.
+  void SetPopDistances(float pop_in_distance, float pop_out_distance);
+
  private:
   const RailDenizenData& Raft() const;
   float PopInDistSq() const;
@@ -91,8 +110,34 @@ class SceneryComponent : public corgi::Component<SceneryData> {
                       SceneryData* scenery_data, SceneryState state);
   void SetVisibilityOnOtherChildren(const corgi::EntityRef& scenery,
                                     bool visible);
+  void UpdateSceneryGrid();
 
   const Config* config_;
+
+  // Every scenery entity, indexed by its index in `scenery_grid_`.
+  std::vector<corgi::EntityRef> scenery_entities_;
+
+  // Broad-phase for pop-in. Holds the position of every scenery entity, so
+  // that hidden scenery far from the raft doesn't have to be visited.
+  SpatialGrid scenery_grid_;
+
+  // Sorted indices of the scenery that isn't hidden. These are visited every
+  // frame, since they have to run their animations and pop out.
+  std::vector<int> visible_scenery_;
+
+  // Scratch buffers for UpdateAllEntities(), kept to avoid reallocating.
+  std::vector<int> nearby_scenery_;
+  std::vector<int> scenery_to_update_;
+
+  // From the rendering config, unless changed with SetPopDistances().
+  float pop_in_distance_;
+  float pop_out_distance_;
+
+  // Longest disappear animation of all the scenery.
+  float max_disappear_time_;
+
+  // True when scenery has been added or removed since the grid was built.
+  bool scenery_grid_dirty_;
 };
 
 }  // zooshi
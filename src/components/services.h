@@ -24,6 +24,7 @@
 #include "fplbase/asset_manager.h"
 #include "fplbase/input.h"
 #include "fplbase/utilities.h"
+#include "job_system.h"
 #include "motive/engine.h"
 #include "pindrop/pindrop.h"
 #include "railmanager.h"
@@ -53,7 +54,8 @@ class ServicesComponent : public corgi::Component<ServicesData> {
                   pindrop::AudioEngine* audio_engine,
                   flatui::FontManager* font_manager, RailManager* rail_manager,
                   corgi::component_library::EntityFactory* entity_factory,
-                  World* world, scene_lab::SceneLab* scene_lab) {
+                  JobSystem* job_system, World* world,
+                  scene_lab::SceneLab* scene_lab) {
     config_ = config;
     asset_manager_ = asset_manager;
     input_system_ = input_system;
@@ -61,6 +63,7 @@ class ServicesComponent : public corgi::Component<ServicesData> {
     font_manager_ = font_manager;
     rail_manager_ = rail_manager;
     entity_factory_ = entity_factory;
+    job_system_ = job_system;
     world_ = world;
     scene_lab_ = scene_lab;
     // The camera is set seperately dependent on the game state.
@@ -80,6 +83,7 @@ class ServicesComponent : public corgi::Component<ServicesData> {
   corgi::component_library::EntityFactory* entity_factory() {
     return entity_factory_;
   }
+  JobSystem* job_system() { return job_system_; }
   World* world() { return world_; }
   // Scene Lab is not guaranteed to be present in all versions of the game.
   scene_lab::SceneLab* scene_lab() { return scene_lab_; }
@@ -119,6 +123,7 @@ class ServicesComponent : public corgi::Component<ServicesData> {
   corgi::EntityRef player_entity_;
   corgi::component_library::EntityFactory* entity_factory_;
   std::string component_def_binary_schema_;
+  JobSystem* job_system_;
   World* world_;
   scene_lab::SceneLab* scene_lab_;
   Camera* camera_;
@@ -0,0 +1,145 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/shadow_caster.h"
+
+#include <algorithm>
+#include "corgi_component_library/rendermesh.h"
+#include "corgi_component_library/transform.h"
+#include "fplbase/mesh.h"
+#include "frustum.h"
+
+CORGI_DEFINE_COMPONENT(fpl::zooshi::ShadowCasterComponent,
+                       fpl::zooshi::ShadowCasterData)
+
+namespace fpl {
+namespace zooshi {
+
+using corgi::component_library::RenderMeshData;
+using corgi::component_library::TransformData;
+using mathfu::mat4;
+
+// A caster that hasn't moved for this many frames is treated as static.
+static const int kFramesUntilStatic = 30;
+
+void ShadowCasterComponent::AddFromRawData(corgi::EntityRef& entity,
+                                           const void* /*raw_data*/) {
+  AddEntity(entity);
+}
+
+bool ShadowCasterComponent::GatherCasters(
+    const corgi::CameraInterface& light_camera) {
+  static_casters_.clear();
+  dynamic_casters_.clear();
+  num_culled_ = 0;
+
+  const Frustum frustum(light_camera.GetTransformMatrix());
+
+  for (auto iter = component_data_.begin(); iter != component_data_.end();
+       ++iter) {
+    const RenderMeshData* rendermesh_data =
+        Data<RenderMeshData>(iter->entity);
+    const TransformData* transform_data = Data<TransformData>(iter->entity);
+    if (rendermesh_data == nullptr || transform_data == nullptr ||
+        rendermesh_data->mesh == nullptr || !rendermesh_data->visible) {
+      continue;
+    }
+
+    // Track how long the caster has been still, whether it's in view or not,
+    // so that it doesn't start out dynamic when it comes into view.
+    ShadowCasterData* caster_data = &iter->data;
+    const mat4& world_transform = transform_data->world_transform;
+    if (SameTransform(world_transform, caster_data->world_transform)) {
+      caster_data->frames_still =
+          std::min(caster_data->frames_still + 1, kFramesUntilStatic);
+    } else {
+      caster_data->world_transform = world_transform;
+      caster_data->frames_still = 0;
+    }
+
+    const fplbase::Mesh* mesh = rendermesh_data->mesh;
+    if (!frustum.IntersectsBox(world_transform, mesh->min_position(),
+                               mesh->max_position())) {
+      num_culled_++;
+      continue;
+    }
+
+    Caster caster;
+    caster.mesh = rendermesh_data->mesh;
+    caster.world_transform = world_transform;
+    if (caster_data->frames_still >= kFramesUntilStatic) {
+      static_casters_.push_back(caster);
+    } else {
+      dynamic_casters_.push_back(caster);
+    }
+  }
+  return !SameCasters(static_casters_, rendered_static_casters_);
+}
+
+void ShadowCasterComponent::RenderStaticPass(
+    const corgi::CameraInterface& light_camera, fplbase::Renderer& renderer,
+    fplbase::Shader* depth_shader) {
+  RenderCasters(static_casters_, light_camera, renderer, depth_shader);
+  rendered_static_casters_ = static_casters_;
+}
+
+void ShadowCasterComponent::RenderDynamicPass(
+    const corgi::CameraInterface& light_camera, fplbase::Renderer& renderer,
+    fplbase::Shader* depth_shader) {
+  RenderCasters(dynamic_casters_, light_camera, renderer, depth_shader);
+}
+
+void ShadowCasterComponent::RenderCasters(
+    const std::vector<Caster>& casters,
+    const corgi::CameraInterface& light_camera, fplbase::Renderer& renderer,
+    fplbase::Shader* depth_shader) {
+  const mat4 light_view_projection = light_camera.GetTransformMatrix();
+  for (auto it = casters.begin(); it != casters.end(); ++it) {
+    renderer.set_model_view_projection(light_view_projection *
+                                       it->world_transform);
+    depth_shader->Set(renderer);
+    it->mesh->Render(renderer);
+  }
+}
+
+bool ShadowCasterComponent::SameTransform(const mat4& a, const mat4& b) {
+  for (int i = 0; i < 16; ++i) {
+    if (a[i] != b[i]) return false;
+  }
+  return true;
+}
+
+bool ShadowCasterComponent::SameCasters(const std::vector<Caster>& a,
+                                        const std::vector<Caster>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].mesh != b[i].mesh ||
+        !SameTransform(a[i].world_transform, b[i].world_transform)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+corgi::ComponentInterface::RawDataUniquePtr
+ShadowCasterComponent::ExportRawData(const corgi::EntityRef& entity) const {
+  if (GetComponentData(entity) == nullptr) return nullptr;
+
+  flatbuffers::FlatBufferBuilder fbb;
+  fbb.Finish(CreateShadowCasterDef(fbb));
+  return fbb.ReleaseBufferPointer();
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,110 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COMPONENTS_SHADOWCASTER_H_
+#define COMPONENTS_SHADOWCASTER_H_
+
+#include <vector>
+#include "components_generated.h"
+#include "corgi/component.h"
+#include "corgi_component_library/camera_interface.h"
+#include "fplbase/mesh.h"
+#include "fplbase/renderer.h"
+#include "fplbase/shader.h"
+#include "mathfu/constants.h"
+#include "mathfu/glsl_mappings.h"
+#include "mathfu/matrix_4x4.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Marks which render meshes cast shadows, and tracks how long they have been
+// still.
+struct ShadowCasterData {
+  ShadowCasterData()
+      : world_transform(mathfu::mat4::Identity()), frames_still(0) {}
+  // The world transform the caster had during the last GatherCasters().
+  mathfu::mat4 world_transform;
+  // The number of GatherCasters() calls since the caster last moved.
+  int frames_still;
+};
+
+// Renders the shadow casters into the shadow maps. Only entities with both a
+// shadow caster and a render mesh are drawn, and only if their bounds touch
+// the light camera's frustum.
+//
+// Casters that have been still for a while are static, and are drawn into a
+// shadow map that can be kept from frame to frame. The others are dynamic,
+// and are drawn into a separate shadow map every frame, so that the raft and
+// the patrons moving don't throw away the static one.
+class ShadowCasterComponent : public corgi::Component<ShadowCasterData> {
+ public:
+  ShadowCasterComponent() : num_culled_(0) {}
+  virtual ~ShadowCasterComponent() {}
+
+  virtual void AddFromRawData(corgi::EntityRef& entity, const void* data);
+  virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
+
+  // Find the visible casters in the light camera's view, and sort them into
+  // static and dynamic ones. Returns true if the static casters, or their
+  // transforms, differ from the ones last drawn by RenderStaticPass().
+  bool GatherCasters(const corgi::CameraInterface& light_camera);
+
+  // Draw the static or the dynamic casters found by the last GatherCasters()
+  // with `depth_shader`. The shadow map must already be the render target.
+  void RenderStaticPass(const corgi::CameraInterface& light_camera,
+                        fplbase::Renderer& renderer,
+                        fplbase::Shader* depth_shader);
+  void RenderDynamicPass(const corgi::CameraInterface& light_camera,
+                         fplbase::Renderer& renderer,
+                         fplbase::Shader* depth_shader);
+
+  // Casters in view and culled by the last GatherCasters().
+  int num_static_casters() const {
+    return static_cast<int>(static_casters_.size());
+  }
+  int num_dynamic_casters() const {
+    return static_cast<int>(dynamic_casters_.size());
+  }
+  int num_culled() const { return num_culled_; }
+
+ private:
+  struct Caster {
+    fplbase::Mesh* mesh;
+    mathfu::mat4 world_transform;
+  };
+
+  static bool SameTransform(const mathfu::mat4& a, const mathfu::mat4& b);
+  static bool SameCasters(const std::vector<Caster>& a,
+                          const std::vector<Caster>& b);
+  static void RenderCasters(const std::vector<Caster>& casters,
+                            const corgi::CameraInterface& light_camera,
+                            fplbase::Renderer& renderer,
+                            fplbase::Shader* depth_shader);
+
+  // The casters in view, and the static ones that are in the static shadow
+  // map.
+  std::vector<Caster> static_casters_;
+  std::vector<Caster> dynamic_casters_;
+  std::vector<Caster> rendered_static_casters_;
+  int num_culled_;
+};
+
+}  // zooshi
+}  // fpl
+
+CORGI_REGISTER_COMPONENT(fpl::zooshi::ShadowCasterComponent,
+                         fpl::zooshi::ShadowCasterData)
+
+#endif  // COMPONENTS_SHADOWCASTER_H_
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "components/shadow_controller.h"
+#include "components/services.h"
 #include "corgi_component_library/transform.h"
 #include "fplbase/utilities.h"
 
@@ -27,6 +28,9 @@ using corgi::component_library::TransformData;
 
 static const float kShadowHeight = 0.15f;
 
+// Number of shadows whose position is updated by each job.
+static const size_t kShadowChunkSize = 256;
+
 void ShadowControllerComponent::AddFromRawData(corgi::EntityRef& entity,
                                                const void* raw_data) {
   auto shadow_controller_def =
@@ -39,6 +43,9 @@ void ShadowControllerComponent::AddFromRawData(corgi::EntityRef& entity,
 
 void ShadowControllerComponent::UpdateAllEntities(
     corgi::WorldTime /*delta_time*/) {
+  // Detach new shadows from their casters on this thread, since that changes
+  // the transform hierarchy.
+  shadows_.clear();
   for (auto iter = component_data_.begin(); iter != component_data_.end();
        ++iter) {
     ShadowControllerData* shadow_data =
@@ -57,13 +64,25 @@ void ShadowControllerComponent::UpdateAllEntities(
           iter->entity);
     }
 
-    TransformData* parent_transform_data =
-        Data<TransformData>(shadow_data->shadow_caster);
-
-    transform_data->position =
-        mathfu::vec3(parent_transform_data->position.x(),
-                     parent_transform_data->position.y(), kShadowHeight);
+    Shadow shadow;
+    shadow.transform = transform_data;
+    shadow.caster_transform = Data<TransformData>(shadow_data->shadow_caster);
+    shadows_.push_back(shadow);
   }
+
+  // Then move every shadow under its caster. Each shadow only writes its own
+  // transform, so disjoint ranges can run in parallel.
+  JobSystem* job_system =
+      entity_manager_->GetComponent<ServicesComponent>()->job_system();
+  job_system->ParallelFor(
+      shadows_.size(), kShadowChunkSize, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          const TransformData* caster_transform = shadows_[i].caster_transform;
+          shadows_[i].transform->position =
+              mathfu::vec3(caster_transform->position.x(),
+                           caster_transform->position.y(), kShadowHeight);
+        }
+      });
 }
 
 corgi::ComponentInterface::RawDataUniquePtr
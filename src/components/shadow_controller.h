@@ -15,8 +15,10 @@
 #ifndef COMPONENTS_SHADOWCONTROLLER_H_
 #define COMPONENTS_SHADOWCONTROLLER_H_
 
+#include <vector>
 #include "components_generated.h"
 #include "corgi/component.h"
+#include "corgi_component_library/transform.h"
 #include "mathfu/constants.h"
 #include "mathfu/glsl_mappings.h"
 #include "mathfu/matrix_4x4.h"
@@ -37,6 +39,16 @@ class ShadowControllerComponent
   virtual void AddFromRawData(corgi::EntityRef& entity, const void* data);
   virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
   virtual void UpdateAllEntities(corgi::WorldTime delta_time);
+
+ private:
+  // A shadow that follows its caster this frame.
+  struct Shadow {
+    corgi::component_library::TransformData* transform;
+    const corgi::component_library::TransformData* caster_transform;
+  };
+
+  // Scratch buffer for UpdateAllEntities(), kept to avoid reallocating.
+  std::vector<Shadow> shadows_;
 };
 
 }  // zooshi
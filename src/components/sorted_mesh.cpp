@@ -0,0 +1,171 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/sorted_mesh.h"
+#include "corgi_component_library/rendermesh.h"
+#include "corgi_component_library/transform.h"
+#include "fplbase/mesh.h"
+#include "frustum.h"
+
+CORGI_DEFINE_COMPONENT(fpl::zooshi::SortedMeshComponent,
+                       fpl::zooshi::SortedMeshData)
+
+namespace fpl {
+namespace zooshi {
+
+using corgi::component_library::RenderMeshData;
+using corgi::component_library::TransformData;
+using mathfu::mat4;
+using mathfu::vec3;
+
+static const unsigned char kOpaquePassMask = 1 << corgi::RenderPass_Opaque;
+
+void SortedMeshComponent::AddFromRawData(corgi::EntityRef& entity,
+                                          const void* /*raw_data*/) {
+  AddEntity(entity);
+}
+
+void SortedMeshComponent::CleanupEntity(corgi::EntityRef& entity) {
+  SortedMeshData* data = GetComponentData(entity);
+  if (data != nullptr) ReturnToPass(data, entity);
+}
+
+void SortedMeshComponent::set_enabled(bool enabled) {
+  enabled_ = enabled;
+  if (enabled_) return;
+  for (auto iter = component_data_.begin(); iter != component_data_.end();
+       ++iter) {
+    ReturnToPass(&iter->data, iter->entity);
+  }
+  draws_.clear();
+  groups_.clear();
+  num_culled_ = 0;
+}
+
+void SortedMeshComponent::ReturnToPass(SortedMeshData* data,
+                                        const corgi::EntityRef& entity) {
+  if (!data->taken_from_pass) return;
+  RenderMeshData* rendermesh_data = Data<RenderMeshData>(entity);
+  if (rendermesh_data != nullptr) rendermesh_data->pass_mask |= kOpaquePassMask;
+  data->taken_from_pass = false;
+}
+
+void SortedMeshComponent::GatherMeshes(const corgi::CameraInterface& camera) {
+  draws_.clear();
+  groups_.clear();
+  num_culled_ = 0;
+
+  // The meshes are only drawn from one viewpoint, so in stereo everything is
+  // left to the render mesh component.
+  const bool sorting = enabled_ && !camera.IsStereo();
+  const Frustum frustum(camera.GetTransformMatrix());
+  const vec3 camera_position = camera.position();
+
+  for (auto iter = component_data_.begin(); iter != component_data_.end();
+       ++iter) {
+    SortedMeshData* data = &iter->data;
+    RenderMeshData* rendermesh_data = Data<RenderMeshData>(iter->entity);
+    const TransformData* transform_data = Data<TransformData>(iter->entity);
+    if (!sorting || rendermesh_data == nullptr || transform_data == nullptr) {
+      ReturnToPass(data, iter->entity);
+      continue;
+    }
+
+    // Take the opaque render meshes out of the render mesh component's pass.
+    if (!data->taken_from_pass) {
+      if ((rendermesh_data->pass_mask & kOpaquePassMask) == 0) continue;
+      rendermesh_data->pass_mask &= ~kOpaquePassMask;
+      data->taken_from_pass = true;
+    }
+    if (rendermesh_data->mesh == nullptr ||
+        rendermesh_data->shader == nullptr || !rendermesh_data->visible) {
+      continue;
+    }
+
+    const mat4& world_transform = transform_data->world_transform;
+    const fplbase::Mesh* mesh = rendermesh_data->mesh;
+    if ((world_transform.TranslationVector3D() - camera_position)
+                .LengthSquared() > cull_distance_squared_ ||
+        !frustum.IntersectsBox(world_transform, mesh->min_position(),
+                               mesh->max_position())) {
+      num_culled_++;
+      continue;
+    }
+
+    Draw draw;
+    draw.shader = rendermesh_data->shader;
+    draw.mesh = rendermesh_data->mesh;
+    draw.world_transform = world_transform;
+    draw.tint = rendermesh_data->tint;
+    draws_.push_back(draw);
+  }
+
+  GroupByRenderState(&draws_, &groups_);
+}
+
+void SortedMeshComponent::RenderMeshes(const corgi::CameraInterface& camera,
+                                       fplbase::Renderer& renderer) {
+  const mat4 camera_transform = camera.GetTransformMatrix();
+  const vec3 camera_position = camera.position();
+  for (auto group = groups_.begin(); group != groups_.end(); ++group) {
+    // Set the shader up with the first draw of the group.
+    const Draw& first = draws_[group->begin];
+    const mat4 first_inverse = first.world_transform.Inverse();
+    renderer.set_camera_pos(first_inverse * camera_position);
+    renderer.set_light_pos(first_inverse * light_position_);
+    renderer.set_color(first.tint);
+    renderer.set_model_view_projection(camera_transform *
+                                       first.world_transform);
+    fplbase::Shader* shader = first.shader;
+    shader->Set(renderer);
+    const fplbase::UniformHandle model_view_projection_uniform =
+        shader->FindUniform("model_view_projection");
+    const fplbase::UniformHandle camera_pos_uniform =
+        shader->FindUniform("camera_pos");
+    const fplbase::UniformHandle light_pos_uniform =
+        shader->FindUniform("light_pos");
+    const fplbase::UniformHandle color_uniform = shader->FindUniform("color");
+
+    // The draws keep the shader bound, and only change the uniforms that
+    // depend on their transforms and tints. Each mesh binds its own materials.
+    for (size_t i = group->begin; i < group->end; ++i) {
+      const Draw& draw = draws_[i];
+      if (i != group->begin) {
+        const mat4 world_matrix_inverse = draw.world_transform.Inverse();
+        const mat4 model_view_projection =
+            camera_transform * draw.world_transform;
+        shader->SetUniform(model_view_projection_uniform,
+                           &model_view_projection[0], 16);
+        shader->SetUniform(camera_pos_uniform,
+                           world_matrix_inverse * camera_position);
+        shader->SetUniform(light_pos_uniform,
+                           world_matrix_inverse * light_position_);
+        shader->SetUniform(color_uniform, draw.tint);
+      }
+      draw.mesh->Render(renderer);
+    }
+  }
+}
+
+corgi::ComponentInterface::RawDataUniquePtr SortedMeshComponent::ExportRawData(
+    const corgi::EntityRef& entity) const {
+  if (GetComponentData(entity) == nullptr) return nullptr;
+
+  flatbuffers::FlatBufferBuilder fbb;
+  fbb.Finish(CreateSortedMeshDef(fbb));
+  return fbb.ReleaseBufferPointer();
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,113 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COMPONENTS_SORTEDMESH_H_
+#define COMPONENTS_SORTEDMESH_H_
+
+#include <vector>
+#include "components_generated.h"
+#include "corgi/component.h"
+#include "corgi_component_library/camera_interface.h"
+#include "fplbase/mesh.h"
+#include "fplbase/renderer.h"
+#include "fplbase/shader.h"
+#include "mathfu/constants.h"
+#include "mathfu/glsl_mappings.h"
+#include "mathfu/matrix_4x4.h"
+#include "render_state_groups.h"
+
+namespace fpl {
+namespace zooshi {
+
+struct SortedMeshData {
+  SortedMeshData() : taken_from_pass(false) {}
+
+  // True while the render mesh is drawn by this component, instead of in the
+  // render mesh component's opaque pass.
+  bool taken_from_pass;
+};
+
+// Draws the opaque render meshes of many copies of the same static prop, such
+// as rocks, grass and trees, sorted by render state. The ones in view are
+// grouped by shader and mesh, so each group's shader is set up once, and the
+// draws of a mesh are next to each other. Each mesh is still drawn on its own,
+// with its own materials.
+class SortedMeshComponent : public corgi::Component<SortedMeshData> {
+ public:
+  SortedMeshComponent()
+      : enabled_(true), cull_distance_squared_(0.0f), num_culled_(0) {}
+  virtual ~SortedMeshComponent() {}
+
+  virtual void AddFromRawData(corgi::EntityRef& entity, const void* data);
+  virtual RawDataUniquePtr ExportRawData(const corgi::EntityRef& entity) const;
+  virtual void CleanupEntity(corgi::EntityRef& entity);
+
+  // While disabled, every render mesh is left in the render mesh component's
+  // opaque pass. Scene Lab disables sorting, so that the render meshes it
+  // edits and exports keep their original passes.
+  void set_enabled(bool enabled);
+  bool enabled() const { return enabled_; }
+
+  // Should match the render mesh component's settings.
+  void set_light_position(const mathfu::vec3& light_position) {
+    light_position_ = light_position;
+  }
+  void SetCullDistance(float cull_distance) {
+    cull_distance_squared_ = cull_distance * cull_distance;
+  }
+
+  // Find the sorted meshes in the camera's view, and group them by render
+  // state. In stereo, or while disabled, the meshes go back to the render mesh
+  // component instead.
+  void GatherMeshes(const corgi::CameraInterface& camera);
+
+  // Draw the meshes found by the last GatherMeshes(), group by group, during
+  // the opaque pass.
+  void RenderMeshes(const corgi::CameraInterface& camera,
+                    fplbase::Renderer& renderer);
+
+  // Render state groups and meshes drawn, and meshes culled, by the last
+  // GatherMeshes().
+  int num_state_groups() const { return static_cast<int>(groups_.size()); }
+  int num_drawn() const { return static_cast<int>(draws_.size()); }
+  int num_culled() const { return num_culled_; }
+
+ private:
+  struct Draw {
+    fplbase::Shader* shader;
+    fplbase::Mesh* mesh;
+    mathfu::mat4 world_transform;
+    mathfu::vec4 tint;
+  };
+
+  // Hand the render mesh back to the render mesh component.
+  void ReturnToPass(SortedMeshData* data, const corgi::EntityRef& entity);
+
+  bool enabled_;
+  mathfu::vec3 light_position_;
+  float cull_distance_squared_;
+
+  // The meshes in view, sorted so that each render state group is contiguous.
+  std::vector<Draw> draws_;
+  std::vector<RenderStateGroup> groups_;
+  int num_culled_;
+};
+
+}  // zooshi
+}  // fpl
+
+CORGI_REGISTER_COMPONENT(fpl::zooshi::SortedMeshComponent,
+                         fpl::zooshi::SortedMeshData)
+
+#endif  // COMPONENTS_SORTEDMESH_H_
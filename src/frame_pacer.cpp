@@ -0,0 +1,67 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frame_pacer.h"
+
+#include <algorithm>
+
+namespace fpl {
+namespace zooshi {
+
+static const Uint64 kMicrosecondsPerSecond = 1000000;
+
+FramePacer::FramePacer() : frame_ticks_(1), spin_ticks_(0), next_deadline_(0) {
+  SDL_AtomicSet(&frame_id_, 0);
+}
+
+void FramePacer::Initialize(int frame_rate, int spin_time) {
+  const Uint64 frequency = SDL_GetPerformanceFrequency();
+  frame_ticks_ = frequency / static_cast<Uint64>(std::max(frame_rate, 1));
+  spin_ticks_ = std::min(
+      frequency * static_cast<Uint64>(std::max(spin_time, 0)) /
+          kMicrosecondsPerSecond,
+      frame_ticks_);
+  next_deadline_ = SDL_GetPerformanceCounter() + frame_ticks_;
+}
+
+int FramePacer::WaitForNextFrame() {
+  const Uint64 frequency = SDL_GetPerformanceFrequency();
+  const Uint64 deadline = next_deadline_;
+  Uint64 now = SDL_GetPerformanceCounter();
+
+  // Sleep in whole milliseconds until the spin time before the deadline.
+  if (now + spin_ticks_ < deadline) {
+    const Uint64 sleep_ms = (deadline - spin_ticks_ - now) * 1000 / frequency;
+    if (sleep_ms > 0) SDL_Delay(static_cast<Uint32>(sleep_ms));
+    now = SDL_GetPerformanceCounter();
+  }
+  while (now < deadline) {
+    now = SDL_GetPerformanceCounter();
+  }
+
+  SDL_AtomicAdd(&frame_id_, 1);
+
+  // When a whole frame or more was missed, skip ahead rather than firing the
+  // missed frames back to back.
+  next_deadline_ = deadline + frame_ticks_;
+  if (now >= next_deadline_) {
+    next_deadline_ += (now - next_deadline_) / frame_ticks_ * frame_ticks_ +
+                      frame_ticks_;
+  }
+  return static_cast<int>((now - deadline) * kMicrosecondsPerSecond /
+                          frequency);
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,54 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_FRAME_PACER_H_
+#define ZOOSHI_FRAME_PACER_H_
+
+#include "SDL_atomic.h"
+#include "SDL_timer.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Wakes up at a fixed frame rate, for platforms that don't report vsync.
+// Deadlines are spaced evenly on the performance counter, so an early or late
+// wake up doesn't shift the frames that follow.
+class FramePacer {
+ public:
+  FramePacer();
+
+  // Pace frames at `frame_rate` per second. The last `spin_time` microseconds
+  // before each deadline are spent spinning instead of sleeping, since sleeps
+  // can overshoot by a millisecond or more.
+  void Initialize(int frame_rate, int spin_time);
+
+  // Sleep until the start of the next frame. Returns how many microseconds
+  // after the deadline it woke up.
+  int WaitForNextFrame();
+
+  // Number of frames started so far, like fplbase::GetVsyncFrameId(). May be
+  // called from any thread.
+  int frame_id() const { return SDL_AtomicGet(&frame_id_); }
+
+ private:
+  Uint64 frame_ticks_;
+  Uint64 spin_ticks_;
+  Uint64 next_deadline_;
+  mutable SDL_atomic_t frame_id_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_FRAME_PACER_H_
@@ -0,0 +1,66 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frustum.h"
+
+#include <algorithm>
+
+using mathfu::mat4;
+using mathfu::vec3;
+using mathfu::vec4;
+
+namespace fpl {
+namespace zooshi {
+
+Frustum::Frustum(const mat4& view_projection) {
+  vec4 rows[4];
+  for (int i = 0; i < 4; ++i) {
+    rows[i] = vec4(view_projection(i, 0), view_projection(i, 1),
+                   view_projection(i, 2), view_projection(i, 3));
+  }
+  for (int i = 0; i < 3; ++i) {
+    planes_[2 * i] = rows[3] + rows[i];
+    planes_[2 * i + 1] = rows[3] - rows[i];
+  }
+  for (int i = 0; i < kNumPlanes; ++i) {
+    planes_[i] /= planes_[i].xyz().Length();
+  }
+}
+
+bool Frustum::IntersectsSphere(const vec3& center, float radius) const {
+  for (int i = 0; i < kNumPlanes; ++i) {
+    if (vec3::DotProduct(planes_[i].xyz(), center) + planes_[i].w() <
+        -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::IntersectsBox(const mat4& world_transform,
+                            const vec3& min_position,
+                            const vec3& max_position) const {
+  // Scale the sphere by the largest axis of the transform.
+  float scale = 0.0f;
+  for (int i = 0; i < 3; ++i) {
+    scale = std::max(scale, vec3(world_transform(0, i), world_transform(1, i),
+                                 world_transform(2, i)).Length());
+  }
+  const vec3 center = world_transform * ((min_position + max_position) * 0.5f);
+  const float radius = (max_position - min_position).Length() * 0.5f * scale;
+  return IntersectsSphere(center, radius);
+}
+
+}  // zooshi
+}  // fpl
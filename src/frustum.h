@@ -0,0 +1,54 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef ZOOSHI_FRUSTUM_H_
+#define ZOOSHI_FRUSTUM_H_
+
+#include "mathfu/constants.h"
+#include "mathfu/glsl_mappings.h"
+#include "mathfu/matrix_4x4.h"
+
+namespace fpl {
+namespace zooshi {
+
+// The view volume of a camera, for culling things that it can't see.
+class Frustum {
+ public:
+  // `view_projection` is the camera's view/projection matrix, such as the
+  // one from CameraInterface::GetTransformMatrix().
+  explicit Frustum(const mathfu::mat4& view_projection);
+
+  // Returns true if the sphere is at least partially inside the frustum.
+  bool IntersectsSphere(const mathfu::vec3& center, float radius) const;
+
+  // Returns true if a sphere around the box from `min_position` to
+  // `max_position`, placed in the world by `world_transform`, is at least
+  // partially inside the frustum.
+  bool IntersectsBox(const mathfu::mat4& world_transform,
+                     const mathfu::vec3& min_position,
+                     const mathfu::vec3& max_position) const;
+
+ private:
+  static const int kNumPlanes = 6;
+
+  // Normals point inwards, and are normalized so that distances to the
+  // planes are in world units.
+  mathfu::vec4 planes_[kNumPlanes];
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_FRUSTUM_H_
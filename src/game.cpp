@@ -15,6 +15,7 @@
 #include "game.h"
 
 #include <stdarg.h>
+#include <stdlib.h>
 
 #include "SDL.h"
 #include "SDL_events.h"
@@ -52,6 +53,8 @@
 #include "motive/math/angle.h"
 #include "motive/util/benchmark.h"
 #include "pindrop/pindrop.h"
+#include "states/states_common.h"
+#include "trace.h"
 #include "world.h"
 
 #ifdef __ANDROID__
@@ -95,8 +98,13 @@ static const int kAndroidTvMaxScreenWidth = 1920;
 static const int kAndroidTvMaxScreenHeight = 1080;
 #endif  // __ANDROID__
 
-static const int kMinUpdateTime = 1000 / 60;
-static const int kMaxUpdateTime = 1000 / 30;
+// Files in the storage directory that the profiler's statistics are saved to.
+static const char kProfileCsvFileName[] = "profile.csv";
+static const char kProfileJsonFileName[] = "profile.json";
+
+// Random seed used in headless mode, so that every run simulates exactly the
+// same frames.
+static const unsigned int kHeadlessRandomSeed = 1;
 
 // Codes used in systrace logging.  Their values don't
 // actually matter much as long as they're unique.
@@ -126,6 +134,9 @@ Game::Game()
       shader_lit_textured_normal_(nullptr),
       shader_textured_(nullptr),
       game_exiting_(false),
+      headless_frames_(0),
+      job_threads_(-1),
+      frame_rate_(0),
       audio_config_(nullptr),
       world_(),
       fader_(),
@@ -388,6 +399,10 @@ bool Game::Initialize(const char* const binary_directory) {
 
   scene_lab_.reset(new scene_lab::SceneLab());
 
+  world_.job_system.Initialize(job_threads_ >= 0
+                                   ? job_threads_
+                                   : std::max(SDL_GetCPUCount() - 2, 0));
+
   world_.Initialize(GetConfig(), &input_, &asset_manager_, &world_renderer_,
                     &font_manager_, &audio_engine_, &graph_factory_, &renderer_,
                     scene_lab_.get());
@@ -441,6 +456,8 @@ bool Game::Initialize(const char* const binary_directory) {
 #endif  // ANDROID_GAMEPAD
 
   world_renderer_.Initialize(&world_);
+  quality_governor_.Initialize(GetConfig().quality_governor_config());
+  ApplyQualityLevel();
 
   scene_lab_->Initialize(GetConfig().scene_lab_config(), &world_.entity_manager,
                          &font_manager_);
@@ -514,6 +531,39 @@ static inline corgi::WorldTime CurrentWorldTimeSubFrame(
   return static_cast<corgi::WorldTime>(input.RealTime() * 1000);
 }
 
+static inline int MicrosecondsBetween(Uint64 start, Uint64 end) {
+  return static_cast<int>((end - start) * 1000000 /
+                          SDL_GetPerformanceFrequency());
+}
+
+// Lock the game update mutex, and report how long the calling thread waited
+// for it through the trace counter `wait_counter`. Returns the time at
+// which the lock was acquired, to be passed to UnlockGameUpdate().
+static Uint64 LockGameUpdate(GameSynchronization& sync,
+                             const char* wait_counter) {
+  const Uint64 start = SDL_GetPerformanceCounter();
+  SDL_LockMutex(sync.gameupdate_mutex_);
+  const Uint64 locked = SDL_GetPerformanceCounter();
+  TraceCounter(wait_counter, MicrosecondsBetween(start, locked));
+  return locked;
+}
+
+// Unlock the game update mutex, and report how long it was held through the
+// trace counter `hold_counter`.
+static void UnlockGameUpdate(GameSynchronization& sync, Uint64 locked,
+                             const char* hold_counter) {
+  SDL_UnlockMutex(sync.gameupdate_mutex_);
+  TraceCounter(hold_counter,
+               MicrosecondsBetween(locked, SDL_GetPerformanceCounter()));
+}
+
+// When tick `tick` starts, in milliseconds since the simulation started. Tick
+// lengths are rounded to whole milliseconds, but alternate so that they
+// average out to exactly `tick_rate` ticks per second.
+static inline int64_t TickStartTime(int64_t tick, int tick_rate) {
+  return tick * corgi::kMillisecondsPerSecond / tick_rate;
+}
+
 // Stuff the update thread needs to know about:
 struct UpdateThreadData {
   UpdateThreadData(bool* exiting, World* world_ptr,
@@ -543,8 +593,13 @@ struct UpdateThreadData {
 static int UpdateThread(void* data) {
   UpdateThreadData* rt_data = static_cast<UpdateThreadData*>(data);
   GameSynchronization& sync = *rt_data->sync;
-  int prev_update_time;
-  prev_update_time = CurrentWorldTime(*rt_data->input) - kMinUpdateTime;
+  World* world = rt_data->world;
+  const Config* config = world->config;
+  const int tick_rate = std::max(config->simulation_tick_rate(), 1);
+  const int max_ticks = std::max(config->max_ticks_per_frame(), 1);
+  // The simulation has run `ticks_done` ticks since `start_time`.
+  const corgi::WorldTime start_time = CurrentWorldTime(*rt_data->input);
+  int64_t ticks_done = 0;
 #ifdef __ANDROID__
   JavaVM* jvm;
   JNIEnv* env = fplbase::AndroidGetJNIEnv();
@@ -570,24 +625,77 @@ static int UpdateThread(void* data) {
     // safely loaded up into openGL and the renderthread is working its way
     // through actually putting everything on the screen.
     // -------------------------------------------
-    SDL_LockMutex(sync.gameupdate_mutex_);
-    const corgi::WorldTime world_time = CurrentWorldTime(*rt_data->input);
-    const corgi::WorldTime delta_time =
-        std::min(world_time - prev_update_time, kMaxUpdateTime);
-    prev_update_time = world_time;
-
-    SystraceAsyncBegin("UpdateGameState", kUpdateGameStateCode);
-    rt_data->state_machine->AdvanceFrame(delta_time);
-    SystraceAsyncEnd("UpdateGameState", kUpdateGameStateCode);
+    const Uint64 update_locked = LockGameUpdate(sync, "UpdateLockWait");
+    const int64_t elapsed_time =
+        CurrentWorldTime(*rt_data->input) - start_time;
+    const int64_t ticks_due =
+        elapsed_time * tick_rate / corgi::kMillisecondsPerSecond;
+    // Time beyond the most ticks allowed in a frame is dropped.
+    ticks_done = std::max(ticks_done, ticks_due - max_ticks);
+    const int num_ticks = static_cast<int>(ticks_due - ticks_done);
+
+    // The simulation continues from the simulated transforms, not the
+    // interpolated ones that were rendered.
+    world->transform_interpolator.Restore(&world->transform_component);
+
+    // Advance the game in fixed ticks, as many as are due. A frame with no
+    // tick due still gets a zero-length update, so that the first update of
+    // each frame handles that frame's input exactly once.
+    TraceAsyncBegin("UpdateGameState", kUpdateGameStateCode);
+    const int state_id = rt_data->state_machine->current_state_id();
+    const int num_updates = std::max(num_ticks, 1);
+    corgi::WorldTime delta_time = 0;
+    int update = 0;
+    for (; update < num_updates; ++update) {
+      // Stop once the state changes, as the new state would otherwise see the
+      // input that made the old state exit.
+      if (rt_data->state_machine->current_state_id() != state_id) break;
+      if (update == num_ticks - 1) {
+        world->transform_interpolator.Capture(&world->transform_component);
+      }
+      const corgi::WorldTime tick_time =
+          num_ticks == 0
+              ? 0
+              : static_cast<corgi::WorldTime>(
+                    TickStartTime(ticks_done + update + 1, tick_rate) -
+                    TickStartTime(ticks_done + update, tick_rate));
+      world->catch_up_tick = update > 0;
+      rt_data->state_machine->AdvanceFrame(tick_time);
+      delta_time += tick_time;
+    }
+    world->catch_up_tick = false;
+    // Ticks skipped because of a state change are dropped, not carried over.
+    ticks_done = ticks_due;
+    TraceCounter("SimulationTicks", std::min(update, num_ticks));
+    TraceAsyncEnd("UpdateGameState", kUpdateGameStateCode);
+
+    // Render part way between the last two ticks, by how far real time is
+    // into the next one. Scene Lab moves entities directly, and a new state
+    // has no previous tick to blend from, so neither is interpolated.
+    const int current_state_id = rt_data->state_machine->current_state_id();
+    if (current_state_id == state_id && state_id != kGameStateSceneLab) {
+      const int64_t tick_start = TickStartTime(ticks_done, tick_rate);
+      const float alpha =
+          static_cast<float>(elapsed_time - tick_start) /
+          static_cast<float>(TickStartTime(ticks_done + 1, tick_rate) -
+                             tick_start);
+      world->transform_interpolator.Interpolate(
+          std::min(std::max(alpha, 0.0f), 1.0f), &world->transform_component);
+    } else {
+      world->transform_interpolator.Clear();
+    }
 
-    SystraceAsyncBegin("UpdateRenderPrep", kUpdateRenderPrepCode);
-    rt_data->state_machine->RenderPrep(rt_data->renderer);
-    SystraceAsyncEnd("UpdateRenderPrep", kUpdateRenderPrepCode);
+    TraceAsyncBegin("UpdateRenderPrep", kUpdateRenderPrepCode);
+    {
+      ProfileScope scope(&world->profiler, "RenderPrep");
+      rt_data->state_machine->RenderPrep(rt_data->renderer);
+    }
+    TraceAsyncEnd("UpdateRenderPrep", kUpdateRenderPrepCode);
 
     rt_data->audio_engine->AdvanceFrame(delta_time / 1000.0f);
 
     *(rt_data->game_exiting) |= rt_data->state_machine->done();
-    SDL_UnlockMutex(sync.gameupdate_mutex_);
+    UnlockGameUpdate(sync, update_locked, "UpdateLockHold");
   }
 
 #ifdef __ANDROID__
@@ -604,14 +712,29 @@ void HandleVsync() {
   SDL_CondBroadcast(global_vsync_context->start_render_cv_);
 }
 
-// Hack, to simulate vsync events on non-android devices.
-static int VsyncSimulatorThread(void* /*data*/) {
-  while (true) {
+#ifndef __ANDROID__
+// Stuff the vsync simulator thread needs to know about:
+struct VsyncSimulatorData {
+  bool* game_exiting;
+  FramePacer* frame_pacer;
+  Profiler* profiler;
+};
+
+// Simulate vsync events on non-android devices, at the configured frame rate.
+static int VsyncSimulatorThread(void* data) {
+  VsyncSimulatorData* vsync_data = static_cast<VsyncSimulatorData*>(data);
+  while (!*(vsync_data->game_exiting)) {
+    const int pacing_error = vsync_data->frame_pacer->WaitForNextFrame();
     HandleVsync();
-    SDL_Delay(2);
+    TraceCounter("FramePacingError", pacing_error);
+    if (vsync_data->profiler->enabled()) {
+      vsync_data->profiler->AddSample("FramePacingError",
+                                      pacing_error / 1000.0);
+    }
   }
   return 0;
 }
+#endif  // __ANDROID__
 
 // For performance, we're using multiple threads so that the game state can
 // be updating in the background while openGL renders.
@@ -630,6 +753,11 @@ static int VsyncSimulatorThread(void* /*data*/) {
 //    next frame.  Once complete, it also goes to sleep and waits for the next
 //    vsync event.
 void Game::Run() {
+  if (headless_frames_ > 0) {
+    RunHeadless(headless_frames_);
+    return;
+  }
+
   // Start the update thread:
   UpdateThreadData rt_data(&game_exiting_, &world_, &state_machine_, &renderer_,
                            &input_, &audio_engine_, &sync_);
@@ -654,9 +782,11 @@ void Game::Run() {
   // variables used for regulating our framerate:
   // Total size of our history, in frames:
   const int kHistorySize = 60 * 5;
+#ifdef __ANDROID__
   // Max number of frames we can have dropped in our history, before we
   // switch to queue-stuffing mode, and ignore vsync pauses.
   const int kMaxDroppedFrames = 3;
+#endif  // __ANDROID__
   // Variable
   bool missed_frame_history[kHistorySize];
   for (int i = 0; i < kHistorySize; i++) {
@@ -664,14 +794,21 @@ void Game::Run() {
   }
   int history_index = 0;
   int total_dropped_frames = 0;
+  int frame_time = 0;
 
   global_vsync_context = &sync_;
 #ifdef __ANDROID__
   fplbase::RegisterVsyncCallback(HandleVsync);
 #else
   // We don't need this on android because we'll just get vsync events directly.
+  const int frame_rate =
+      frame_rate_ > 0 ? frame_rate_ : GetConfig().frame_rate();
+  frame_pacer_.Initialize(frame_rate, GetConfig().frame_pacing_spin_time());
+  LogInfo("Pacing frames at %d frames/second.", frame_rate);
+  VsyncSimulatorData vsync_data = {&game_exiting_, &frame_pacer_,
+                                   &world_.profiler};
   SDL_Thread* vsync_simulator_thread = SDL_CreateThread(
-      VsyncSimulatorThread, "Zooshi Simulated Vsync Thread", nullptr);
+      VsyncSimulatorThread, "Zooshi Simulated Vsync Thread", &vsync_data);
   if (!vsync_simulator_thread) {
     LogError("Error creating vsync simulator thread.");
     assert(false);
@@ -686,7 +823,7 @@ void Game::Run() {
 #ifdef __ANDROID__
     int current_frame_id = fplbase::GetVsyncFrameId();
 #else
-    int current_frame_id = 0;
+    int current_frame_id = frame_pacer_.frame_id();
 #endif  // __ANDROID__
     // Update our framerate history:
     // The oldest value falls off and is replaced with the most recent frame.
@@ -700,7 +837,8 @@ void Game::Run() {
     missed_frame_history[history_index] =
         (current_frame_id != last_frame_id + 1) &&
         (current_frame_id != last_frame_id);
-    if (missed_frame_history[history_index]) {
+    const bool missed_frame = missed_frame_history[history_index];
+    if (missed_frame) {
       total_dropped_frames++;
     }
     history_index = (history_index + 1) % kHistorySize;
@@ -709,26 +847,41 @@ void Game::Run() {
     // -------------------------------------------
     // Steps 1, 2.
     // Wait for start of frame.  (triggered at vsync start on android.)
+#ifdef __ANDROID__
     // For performance, we only wait if we're not dropping frames.  Otherwise,
     // we just keep rendering as fast as we can and stuff the render queue.
     if (total_dropped_frames <= kMaxDroppedFrames) {
       SDL_CondWait(sync_.start_render_cv_, sync_.renderthread_mutex_);
     }
+#else
+    // The frame pacer already starts late frames as soon as they're due, and
+    // rendering ahead of it would defeat the pacing.
+    SDL_CondWait(sync_.start_render_cv_, sync_.renderthread_mutex_);
+#endif  // __ANDROID__
+    TraceFrame();
 
     // Grab the lock to make sure the game isn't still updating.
-    SDL_LockMutex(sync_.gameupdate_mutex_);
+    const Uint64 render_locked = LockGameUpdate(sync_, "RenderLockWait");
+
+    // Adjust the rendering quality to the last frame, while the update
+    // thread is not using the settings. Only gameplay frames count, as
+    // loading and menus aren't representative.
+    if (state_machine_.current_state_id() == kGameStateGameplay &&
+        quality_governor_.AdvanceFrame(frame_time, missed_frame)) {
+      ApplyQualityLevel();
+    }
 
-    SystraceBegin("RenderFrame");
+    TraceBegin("RenderFrame");
 
     // Input update must happen from the render thread.
     // From the SDL documentation on SDL_PollEvent(),
     // https://wiki.libsdl.org/SDL_PollEvent):
     // "As this function implicitly calls SDL_PumpEvents(), you can only call
     // this function in the thread that set the video mode."
-    SystraceBegin("Input::AdvanceFrame()");
+    TraceBegin("Input::AdvanceFrame()");
     input_.AdvanceFrame(&renderer_.window_size());
     game_exiting_ |= input_.exit_requested();
-    SystraceEnd();
+    TraceEnd();
 
     // Milliseconds elapsed since last update.
     rt_data.frame_start = CurrentWorldTimeSubFrame(input_);
@@ -737,20 +890,26 @@ void Game::Run() {
     // Step 3.
     // Render everything.
     // -------------------------------------------
-    SystraceBegin("StateMachine::Render()");
+    TraceBegin("StateMachine::Render()");
 
     fplbase::RenderTarget::ScreenRenderTarget(renderer_).SetAsRenderTarget();
     renderer_.ClearDepthBuffer();
     renderer_.SetCulling(fplbase::Renderer::kCullBack);
 
-    state_machine_.Render(&renderer_);
-    SystraceEnd();
+    {
+      ProfileScope scope(&world_.profiler, "Render");
+      state_machine_.Render(&renderer_);
+    }
+    TraceEnd();
 
-    SDL_UnlockMutex(sync_.gameupdate_mutex_);
+    UnlockGameUpdate(sync_, render_locked, "RenderLockHold");
 
-    SystraceBegin("StateMachine::HandleUI()");
-    state_machine_.HandleUI(&renderer_);
-    SystraceEnd();
+    TraceBegin("StateMachine::HandleUI()");
+    {
+      ProfileScope scope(&world_.profiler, "HandleUI");
+      state_machine_.HandleUI(&renderer_);
+    }
+    TraceEnd();
 
     // -------------------------------------------
     // Step 4.
@@ -766,11 +925,11 @@ void Game::Run() {
     // but that's ok because the update thread is humming in the background
     // preparing the worlds tate for next frame.
     // -------------------------------------------
-    SystraceBegin("AdvanceFrame");
+    TraceBegin("AdvanceFrame");
     renderer_.AdvanceFrame(input_.minimized(), input_.Time());
-    SystraceEnd();  // AdvanceFrame
+    TraceEnd();  // AdvanceFrame
 
-    SystraceEnd();  // RenderFrame
+    TraceEnd();  // RenderFrame
 
     gpg_manager_.Update();
 
@@ -779,16 +938,36 @@ void Game::Run() {
     if (input_.GetButton(fplbase::FPLK_BACKQUOTE).went_down()) {
       ToggleRelativeMouseMode();
     }
+    // F6 starts and stops profiling, F7 saves the statistics collected so far.
+    if (input_.GetButton(fplbase::FPLK_F6).went_down()) {
+      const bool profiling = !world_.profiler.enabled();
+      if (profiling) world_.profiler.Reset();
+      world_.profiler.set_enabled(profiling);
+      LogInfo("Profiler %s.", profiling ? "started" : "stopped");
+    }
+    if (input_.GetButton(fplbase::FPLK_F7).went_down()) {
+      SaveProfile();
+    }
 
     int new_time = CurrentWorldTimeSubFrame(input_);
-    int frame_time = new_time - rt_data.frame_start;
+    frame_time = new_time - rt_data.frame_start;
+    if (world_.profiler.enabled()) {
+      world_.profiler.AddSample("Frame", frame_time);
+    }
 #if DISPLAY_FRAMERATE_HISTOGRAM
     UpdateProfiling(frame_time);
 #endif  // DISPLAY_FRAMERATE_HISTOGRAM
 
-    SystraceCounter("FrameTime", frame_time);
+    TraceCounter("FrameTime", frame_time);
   }
   SDL_UnlockMutex(sync_.renderthread_mutex_);
+#ifndef __ANDROID__
+  SDL_WaitThread(vsync_simulator_thread, nullptr);
+#endif  // __ANDROID__
+  TraceFlush();
+  if (world_.profiler.enabled()) {
+    SaveProfile();
+  }
 // Clean up asynchronous callbacks to prevent crashing on garbage data.
 #ifdef __ANDROID__
   fplbase::RegisterVsyncCallback(nullptr);
@@ -796,6 +975,97 @@ void Game::Run() {
   input_.AddAppEventCallback(nullptr);
 }
 
+// Simulate gameplay on this thread one tick per frame, as fast as
+// possible. Nothing is rendered, the asset manager never creates GPU
+// resources for the meshes and textures it loads, and the rivers only create
+// their physics. The simulation speed is logged at the end, and the time
+// spent updating each component is saved like any other profile.
+void Game::RunHeadless(int num_frames) {
+  srand(kHeadlessRandomSeed);
+  world_.river_component.set_create_render_meshes(false);
+  LoadWorldDef(&world_, GetConfig().world_def());
+  world_.player_component.set_state(kPlayerState_Active);
+  world_.SetActiveController(kControllerDefault);
+  Camera camera;
+  world_.services_component.set_camera(&camera);
+
+  const int tick_rate = std::max(GetConfig().simulation_tick_rate(), 1);
+  world_.profiler.Reset();
+  world_.profiler.set_enabled(true);
+  const Uint64 start = SDL_GetPerformanceCounter();
+  for (int frame = 0; frame < num_frames; ++frame) {
+    TraceFrame();
+    world_.river_component.UpdateRiverMeshes();
+    world_.river_component.FinishRiverMeshes();
+    // Ticks are as long as in the game loop.
+    const corgi::WorldTime tick_time = static_cast<corgi::WorldTime>(
+        TickStartTime(frame + 1, tick_rate) - TickStartTime(frame, tick_rate));
+    world_.UpdateComponents(tick_time);
+    UpdateMainCamera(&camera, &world_);
+  }
+  const double seconds =
+      static_cast<double>(SDL_GetPerformanceCounter() - start) /
+      static_cast<double>(SDL_GetPerformanceFrequency());
+
+  LogInfo("Headless: simulated %d frames in %.3f seconds (%.1f frames/second)",
+          num_frames, seconds, num_frames / seconds);
+  TraceFlush();
+  SaveProfile();
+  world_.profiler.set_enabled(false);
+  world_.services_component.set_camera(nullptr);
+}
+
+// Apply the quality governor's current level to the rendering config's
+// settings.
+void Game::ApplyQualityLevel() {
+  const QualityLevel* level = quality_governor_.current_level();
+  if (!level) return;
+  const RenderConfig* rendering_config = GetConfig().rendering_config();
+  const float scale = level->distance_scale();
+  world_renderer_.SetShadowMapResolution(level->shadow_map_resolution());
+  world_renderer_.set_create_shadow_map(rendering_config->create_shadow_map() &&
+                                        level->create_shadow_map());
+  world_renderer_.SetFogDistances(rendering_config->fog_roll_in_dist() * scale,
+                                  rendering_config->fog_max_dist() * scale);
+  world_.render_mesh_component.SetCullDistance(
+      rendering_config->cull_distance() * scale);
+  world_.sorted_mesh_component.SetCullDistance(
+      rendering_config->cull_distance() * scale);
+  world_.scenery_component.SetPopDistances(
+      rendering_config->pop_in_distance() * scale,
+      rendering_config->pop_out_distance() * scale);
+  LogInfo("Quality level %d: shadow map %s at %d, cull distance %.1f, "
+          "pop in/out distance %.1f/%.1f, fog %.0f to %.0f.",
+          quality_governor_.level(),
+          world_renderer_.create_shadow_map() ? "on" : "off",
+          world_renderer_.shadow_map_resolution(),
+          rendering_config->cull_distance() * scale,
+          rendering_config->pop_in_distance() * scale,
+          rendering_config->pop_out_distance() * scale,
+          rendering_config->fog_roll_in_dist() * scale,
+          rendering_config->fog_max_dist() * scale);
+}
+
+// Log the profiler's statistics, and save them as CSV and JSON in the storage
+// directory.
+void Game::SaveProfile() {
+  world_.profiler.LogStats();
+  LogInfo("Shadow map cache hit rate: %.1f%%",
+          100.0f * world_renderer_.shadow_map_cache_hit_rate());
+  std::string storage_path;
+  if (!fplbase::GetStoragePath(kSaveAppName, &storage_path)) {
+    LogError("Couldn't find a directory to save the profile to.");
+    return;
+  }
+  const std::string csv_file_name = storage_path + kProfileCsvFileName;
+  const std::string json_file_name = storage_path + kProfileJsonFileName;
+  if (world_.profiler.SaveCsv(csv_file_name.c_str()) &&
+      world_.profiler.SaveJson(json_file_name.c_str())) {
+    LogInfo("Saved profile to %s and %s.", csv_file_name.c_str(),
+            json_file_name.c_str());
+  }
+}
+
 #if DISPLAY_FRAMERATE_HISTOGRAM
 static const int kSampleDuration = 5;  // in seconds
 static const int kTargetFPS = 60;      // Used for calculating dropped frames
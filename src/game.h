@@ -29,10 +29,12 @@
 #include "fplbase/input.h"
 #include "fplbase/renderer.h"
 #include "fplbase/utilities.h"
+#include "frame_pacer.h"
 #include "full_screen_fader.h"
 #include "mathfu/glsl_mappings.h"
 #include "module_library/default_graph_factory.h"
 #include "pindrop/pindrop.h"
+#include "quality_governor.h"
 #include "rail_def_generated.h"
 #include "states/intro_state.h"
 #include "states/loading_state.h"
@@ -98,6 +100,19 @@ class Game {
   bool Initialize(const char* const binary_directory);
   void Run();
 
+  // When `num_frames` is positive, Run() simulates that many frames of
+  // gameplay as fast as possible, without rendering, and reports how long the
+  // updates took instead of running the game.
+  void set_headless_frames(int num_frames) { headless_frames_ = num_frames; }
+
+  // Number of worker threads in the job system. When negative, the game uses
+  // all the cores not taken by the render and update threads.
+  void set_job_threads(int num_threads) { job_threads_ = num_threads; }
+
+  // Frames per second to pace rendering at on desktop. When 0, the game uses
+  // the rate in the config.
+  void set_frame_rate(int frame_rate) { frame_rate_ = frame_rate; }
+
   // Set the overlay directory name to optionally load assets from.
   static void SetOverlayName(const char* overlay_name) {
     overlay_name_ = overlay_name;
@@ -129,6 +144,10 @@ class Game {
   void ToggleRelativeMouseMode();
 
   void UpdateProfiling(corgi::WorldTime frame_time);
+  void SaveProfile();
+  void ApplyQualityLevel();
+
+  void RunHeadless(int num_frames);
 
   // Overrides fplbase::LoadFile() in order to optionally load files from
   // overlay directories.
@@ -187,6 +206,18 @@ class Game {
 
   bool game_exiting_;
 
+  // Number of frames to simulate in headless mode, or 0 to run the game.
+  int headless_frames_;
+
+  // Number of job system worker threads, or negative to pick automatically.
+  int job_threads_;
+
+  // Frame rate to pace rendering at on desktop, or 0 to use the config's.
+  int frame_rate_;
+
+  // Stands in for vsync on desktop.
+  FramePacer frame_pacer_;
+
   std::string rail_source_;
 
   pindrop::AudioConfig* audio_config_;
@@ -194,6 +225,9 @@ class Game {
   World world_;
   WorldRenderer world_renderer_;
 
+  // Lowers the rendering quality when frames are too slow.
+  QualityGovernor quality_governor_;
+
   // Fade the screen to back and from black.
   FullScreenFader fader_;
 
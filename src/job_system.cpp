@@ -0,0 +1,187 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "job_system.h"
+
+#include <algorithm>
+#include "fplbase/utilities.h"
+
+namespace fpl {
+namespace zooshi {
+
+JobSystem::JobSystem()
+    : function_(nullptr),
+      mutex_(SDL_CreateMutex()),
+      start_cv_(SDL_CreateCond()),
+      done_cv_(SDL_CreateCond()),
+      generation_(0),
+      exiting_(false) {
+  SDL_AtomicSet(&remaining_chunks_, 0);
+  queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+}
+
+JobSystem::~JobSystem() {
+  Shutdown();
+  SDL_DestroyCond(done_cv_);
+  SDL_DestroyCond(start_cv_);
+  SDL_DestroyMutex(mutex_);
+}
+
+void JobSystem::Initialize(int num_threads) {
+  Shutdown();
+  exiting_ = false;
+
+  // The worker data must not move once the threads have started.
+  worker_data_.resize(static_cast<size_t>(std::max(num_threads, 0)));
+  for (size_t i = 0; i < worker_data_.size(); ++i) {
+    queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+    worker_data_[i].job_system = this;
+    worker_data_[i].queue = i + 1;
+  }
+  for (size_t i = 0; i < worker_data_.size(); ++i) {
+    SDL_Thread* thread =
+        SDL_CreateThread(WorkerThread, "Zooshi Job Thread", &worker_data_[i]);
+    if (!thread) {
+      fplbase::LogError("Error creating job thread.");
+      break;
+    }
+    threads_.push_back(thread);
+  }
+  fplbase::LogInfo("Job system started %d worker threads.",
+                   static_cast<int>(threads_.size()));
+}
+
+void JobSystem::Shutdown() {
+  SDL_LockMutex(mutex_);
+  exiting_ = true;
+  SDL_CondBroadcast(start_cv_);
+  SDL_UnlockMutex(mutex_);
+  for (auto it = threads_.begin(); it != threads_.end(); ++it) {
+    SDL_WaitThread(*it, nullptr);
+  }
+  threads_.clear();
+  worker_data_.clear();
+  queues_.resize(1);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t chunk_size,
+                            const RangeFunction& function) {
+  if (count == 0) return;
+  chunk_size = std::max(chunk_size, static_cast<size_t>(1));
+  // A loop that fits in one chunk runs right here, without waking anyone.
+  if (threads_.empty() || count <= chunk_size) {
+    function(0, count);
+    return;
+  }
+
+  // The function must be set before any chunk can be popped, since workers
+  // still looking for chunks of the previous loop may pop them right away.
+  function_ = &function;
+  const size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+  SDL_AtomicSet(&remaining_chunks_, static_cast<int>(num_chunks));
+  for (size_t i = 0; i < num_chunks; ++i) {
+    Chunk chunk;
+    chunk.begin = i * chunk_size;
+    chunk.end = std::min(chunk.begin + chunk_size, count);
+    Queue* queue = queues_[i % queues_.size()].get();
+    SDL_LockMutex(queue->mutex);
+    queue->chunks.push_back(chunk);
+    SDL_UnlockMutex(queue->mutex);
+  }
+
+  // The calling thread takes one chunk, so only wake a worker for each of the
+  // others.
+  const size_t num_wakes = std::min(num_chunks - 1, threads_.size());
+  SDL_LockMutex(mutex_);
+  ++generation_;
+  for (size_t i = 0; i < num_wakes; ++i) {
+    SDL_CondSignal(start_cv_);
+  }
+  SDL_UnlockMutex(mutex_);
+
+  RunChunks(0);
+
+  // Wait for the chunks that other threads are still running.
+  SDL_LockMutex(mutex_);
+  while (SDL_AtomicGet(&remaining_chunks_) > 0) {
+    SDL_CondWait(done_cv_, mutex_);
+  }
+  SDL_UnlockMutex(mutex_);
+  function_ = nullptr;
+}
+
+// Take the most recently added chunk from `queue`, or else the oldest chunk
+// of another queue. Returns false if all the queues are empty.
+bool JobSystem::PopChunk(size_t queue, Chunk* chunk) {
+  Queue* own = queues_[queue].get();
+  SDL_LockMutex(own->mutex);
+  const bool found = !own->chunks.empty();
+  if (found) {
+    *chunk = own->chunks.back();
+    own->chunks.pop_back();
+  }
+  SDL_UnlockMutex(own->mutex);
+  if (found) return true;
+
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    Queue* victim = queues_[(queue + i) % queues_.size()].get();
+    SDL_LockMutex(victim->mutex);
+    const bool stolen = !victim->chunks.empty();
+    if (stolen) {
+      *chunk = victim->chunks.front();
+      victim->chunks.pop_front();
+    }
+    SDL_UnlockMutex(victim->mutex);
+    if (stolen) return true;
+  }
+  return false;
+}
+
+void JobSystem::RunChunks(size_t queue) {
+  Chunk chunk;
+  while (PopChunk(queue, &chunk)) {
+    (*function_)(chunk.begin, chunk.end);
+    // SDL_AtomicAdd() returns the previous value.
+    if (SDL_AtomicAdd(&remaining_chunks_, -1) == 1) {
+      SDL_LockMutex(mutex_);
+      SDL_CondSignal(done_cv_);
+      SDL_UnlockMutex(mutex_);
+    }
+  }
+}
+
+void JobSystem::WorkerLoop(size_t queue) {
+  SDL_LockMutex(mutex_);
+  int generation = generation_;
+  while (true) {
+    while (!exiting_ && generation == generation_) {
+      SDL_CondWait(start_cv_, mutex_);
+    }
+    if (exiting_) break;
+    generation = generation_;
+    SDL_UnlockMutex(mutex_);
+    RunChunks(queue);
+    SDL_LockMutex(mutex_);
+  }
+  SDL_UnlockMutex(mutex_);
+}
+
+int JobSystem::WorkerThread(void* data) {
+  WorkerData* worker_data = static_cast<WorkerData*>(data);
+  worker_data->job_system->WorkerLoop(worker_data->queue);
+  return 0;
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,110 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_JOB_SYSTEM_H_
+#define ZOOSHI_JOB_SYSTEM_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "SDL_atomic.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Pool of worker threads that runs the chunks of data-parallel loops.
+//
+// ParallelFor() deals the chunks of a loop out to one queue per thread. Each
+// thread runs the chunks of its own queue, and once that is empty it steals
+// chunks from the other queues, so chunks of uneven cost still keep every
+// thread busy. The calling thread works on the loop too.
+class JobSystem {
+ public:
+  typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+  JobSystem();
+  ~JobSystem();
+
+  // Start `num_threads` worker threads. With no worker threads, ParallelFor()
+  // runs everything on the calling thread.
+  void Initialize(int num_threads);
+
+  // Stop and join the worker threads.
+  void Shutdown();
+
+  int num_threads() const { return static_cast<int>(threads_.size()); }
+
+  // Call `function` on consecutive ranges of at most `chunk_size` elements
+  // that together cover [0, `count`), and return once all of them are done.
+  // `function` is called concurrently on disjoint ranges. If `count` fits in
+  // one chunk, or there are no worker threads, `function` is called once on
+  // the calling thread, with the whole of [0, `count`). Must not be called
+  // from more than one thread at a time, or from within `function`.
+  void ParallelFor(size_t count, size_t chunk_size,
+                   const RangeFunction& function);
+
+ private:
+  struct Chunk {
+    size_t begin;
+    size_t end;
+  };
+
+  struct Queue {
+    Queue() : mutex(SDL_CreateMutex()) {}
+    ~Queue() { SDL_DestroyMutex(mutex); }
+    SDL_mutex* mutex;
+    std::deque<Chunk> chunks;
+  };
+
+  struct WorkerData {
+    JobSystem* job_system;
+    size_t queue;
+  };
+
+  bool PopChunk(size_t queue, Chunk* chunk);
+  void RunChunks(size_t queue);
+  void WorkerLoop(size_t queue);
+  static int WorkerThread(void* data);
+
+  std::vector<SDL_Thread*> threads_;
+  std::vector<WorkerData> worker_data_;
+
+  // One queue per worker thread, plus queue 0 for the calling thread.
+  std::vector<std::unique_ptr<Queue>> queues_;
+
+  // The function of the loop that is running.
+  const RangeFunction* function_;
+
+  // Number of chunks of the running loop that haven't finished yet.
+  SDL_atomic_t remaining_chunks_;
+
+  // Guards `generation_` and `exiting_`, and is used with the condition
+  // variables below.
+  SDL_mutex* mutex_;
+  SDL_cond* start_cv_;
+  SDL_cond* done_cv_;
+
+  // Incremented every time a loop starts. The workers that are woken up run
+  // chunks until none are left.
+  int generation_;
+  bool exiting_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_JOB_SYSTEM_H_
@@ -12,10 +12,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 
 #include "fplbase/utilities.h"
 #include "game.h"
+#include "trace.h"
+
+#if !defined(__ANDROID__)
+// Number of frames simulated by "--headless" when no count is given.
+static const int kDefaultHeadlessFrames = 3600;
+
+// File in the storage directory that "--trace" saves the trace to.
+static const char kTraceFileName[] = "trace.json";
+#endif  // !defined(__ANDROID__)
 
 extern "C" int FPL_main(int argc, char* argv[]) {
   fpl::zooshi::Game game;
@@ -29,7 +40,33 @@ extern "C" int FPL_main(int argc, char* argv[]) {
                                          &launch_mode, &overlay);
   fpl::zooshi::Game::SetOverlayName(overlay.c_str());
 #else
-  fpl::zooshi::Game::SetOverlayName(argc > 1 ? argv[1] : "");
+  // Usage: zooshi [--headless [num_frames]] [--job-threads num_threads]
+  //               [--trace first_frame num_frames] [--frame-rate fps]
+  //               [overlay]
+  const char* overlay = "";
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--headless") == 0) {
+      int num_frames = kDefaultHeadlessFrames;
+      if (i + 1 < argc && atoi(argv[i + 1]) > 0) {
+        num_frames = atoi(argv[++i]);
+      }
+      game.set_headless_frames(num_frames);
+    } else if (strcmp(argv[i], "--job-threads") == 0 && i + 1 < argc) {
+      game.set_job_threads(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--frame-rate") == 0 && i + 1 < argc) {
+      game.set_frame_rate(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 2 < argc) {
+      const int first_frame = atoi(argv[++i]);
+      const int num_frames = atoi(argv[++i]);
+      std::string storage_path;
+      fplbase::GetStoragePath(fpl::zooshi::kSaveAppName, &storage_path);
+      fpl::zooshi::TraceCaptureFrames(first_frame, num_frames,
+                                      storage_path + kTraceFileName);
+    } else {
+      overlay = argv[i];
+    }
+  }
+  fpl::zooshi::Game::SetOverlayName(overlay);
 #endif  // defined(__ANDROID__)
 
   if (!game.Initialize(binary_directory)) {
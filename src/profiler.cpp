@@ -0,0 +1,153 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "fplbase/utilities.h"
+
+namespace fpl {
+namespace zooshi {
+
+// The value below which `percentile` percent of the sorted `samples` lie.
+static double Percentile(const std::vector<double>& samples,
+                         double percentile) {
+  if (samples.empty()) return 0.0;
+  const size_t rank = static_cast<size_t>(
+      percentile / 100.0 * static_cast<double>(samples.size() - 1) + 0.5);
+  return samples[rank];
+}
+
+Profiler::Profiler(size_t window_size)
+    : window_size_(std::max(window_size, static_cast<size_t>(1))),
+      mutex_(SDL_CreateMutex()) {
+  SDL_AtomicSet(&enabled_, 0);
+}
+
+Profiler::~Profiler() { SDL_DestroyMutex(mutex_); }
+
+// Sections are looked up by pointer first, since the same string literal is
+// passed in every frame.
+Profiler::Section* Profiler::FindSection(const char* name) {
+  for (auto it = sections_.begin(); it != sections_.end(); ++it) {
+    if (it->name == name) return &*it;
+  }
+  for (auto it = sections_.begin(); it != sections_.end(); ++it) {
+    if (strcmp(it->name, name) == 0) return &*it;
+  }
+  Section section;
+  section.name = name;
+  section.samples.reserve(window_size_);
+  section.next_sample = 0;
+  section.count = 0;
+  section.total = 0.0;
+  sections_.push_back(section);
+  return &sections_.back();
+}
+
+void Profiler::AddSample(const char* name, double milliseconds) {
+  SDL_LockMutex(mutex_);
+  Section* section = FindSection(name);
+  if (section->samples.size() < window_size_) {
+    section->samples.push_back(milliseconds);
+  } else {
+    section->samples[section->next_sample] = milliseconds;
+  }
+  section->next_sample = (section->next_sample + 1) % window_size_;
+  section->count++;
+  section->total += milliseconds;
+  SDL_UnlockMutex(mutex_);
+}
+
+void Profiler::Reset() {
+  SDL_LockMutex(mutex_);
+  sections_.clear();
+  SDL_UnlockMutex(mutex_);
+}
+
+void Profiler::GetStats(std::vector<ProfileStats>* stats) const {
+  stats->clear();
+  std::vector<double> sorted;
+  SDL_LockMutex(mutex_);
+  for (auto it = sections_.begin(); it != sections_.end(); ++it) {
+    sorted = it->samples;
+    std::sort(sorted.begin(), sorted.end());
+    ProfileStats section_stats;
+    section_stats.name = it->name;
+    section_stats.count = it->count;
+    section_stats.mean = it->count > 0 ? it->total / it->count : 0.0;
+    section_stats.p50 = Percentile(sorted, 50.0);
+    section_stats.p95 = Percentile(sorted, 95.0);
+    section_stats.p99 = Percentile(sorted, 99.0);
+    section_stats.max = sorted.empty() ? 0.0 : sorted.back();
+    stats->push_back(section_stats);
+  }
+  SDL_UnlockMutex(mutex_);
+}
+
+bool Profiler::SaveCsv(const char* filename) const {
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    fplbase::LogError("Couldn't write profile to %s", filename);
+    return false;
+  }
+  std::vector<ProfileStats> stats;
+  GetStats(&stats);
+  fprintf(file, "section,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+  for (auto it = stats.begin(); it != stats.end(); ++it) {
+    fprintf(file, "%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f\n", it->name, it->count,
+            it->mean, it->p50, it->p95, it->p99, it->max);
+  }
+  fclose(file);
+  return true;
+}
+
+bool Profiler::SaveJson(const char* filename) const {
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    fplbase::LogError("Couldn't write profile to %s", filename);
+    return false;
+  }
+  std::vector<ProfileStats> stats;
+  GetStats(&stats);
+  fprintf(file, "{\n  \"window_size\": %d,\n  \"sections\": [",
+          static_cast<int>(window_size_));
+  for (auto it = stats.begin(); it != stats.end(); ++it) {
+    fprintf(file,
+            "%s\n    {\"name\": \"%s\", \"count\": %d, \"mean_ms\": %.4f, "
+            "\"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, "
+            "\"max_ms\": %.4f}",
+            it == stats.begin() ? "" : ",", it->name, it->count, it->mean,
+            it->p50, it->p95, it->p99, it->max);
+  }
+  fprintf(file, "\n  ]\n}\n");
+  fclose(file);
+  return true;
+}
+
+void Profiler::LogStats() const {
+  std::vector<ProfileStats> stats;
+  GetStats(&stats);
+  fplbase::LogInfo("%-24s %8s %8s %8s %8s %8s %8s", "Section", "Count",
+                   "Mean", "p50", "p95", "p99", "Max");
+  for (auto it = stats.begin(); it != stats.end(); ++it) {
+    fplbase::LogInfo("%-24s %8d %8.3f %8.3f %8.3f %8.3f %8.3f", it->name,
+                     it->count, it->mean, it->p50, it->p95, it->p99, it->max);
+  }
+}
+
+}  // zooshi
+}  // fpl
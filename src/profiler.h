@@ -0,0 +1,114 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_PROFILER_H_
+#define ZOOSHI_PROFILER_H_
+
+#include <vector>
+#include "SDL_atomic.h"
+#include "SDL_mutex.h"
+#include "SDL_timer.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Statistics of one profiled section, in milliseconds. The percentiles and
+// the maximum cover the most recent samples only, the mean covers every
+// sample since the profiler was last reset.
+struct ProfileStats {
+  const char* name;
+  int count;
+  double mean;
+  double p50;
+  double p95;
+  double p99;
+  double max;
+};
+
+// Collects the time spent in named sections of a frame, such as the update of
+// a component or a render pass, while it is enabled. Samples can be added from
+// any thread.
+class Profiler {
+ public:
+  explicit Profiler(size_t window_size);
+  ~Profiler();
+
+  void set_enabled(bool enabled) { SDL_AtomicSet(&enabled_, enabled ? 1 : 0); }
+  bool enabled() const { return SDL_AtomicGet(&enabled_) != 0; }
+
+  // Record that the section `name` took `milliseconds`. `name` must stay
+  // valid for as long as the profiler, so it is usually a string literal.
+  void AddSample(const char* name, double milliseconds);
+
+  // Forget every sample.
+  void Reset();
+
+  // Get the statistics of every section, in the order in which they were
+  // first sampled.
+  void GetStats(std::vector<ProfileStats>* stats) const;
+
+  // Write the statistics of every section to `filename`.
+  bool SaveCsv(const char* filename) const;
+  bool SaveJson(const char* filename) const;
+
+  // Log the statistics of every section.
+  void LogStats() const;
+
+ private:
+  struct Section {
+    const char* name;
+    // Ring buffer of the most recent samples.
+    std::vector<double> samples;
+    size_t next_sample;
+    int count;
+    double total;
+  };
+
+  Section* FindSection(const char* name);
+
+  size_t window_size_;
+  mutable SDL_atomic_t enabled_;
+
+  // Guards `sections_`.
+  SDL_mutex* mutex_;
+  std::vector<Section> sections_;
+};
+
+// Adds the time between its construction and destruction to a section of
+// `profiler`, if the profiler is enabled.
+class ProfileScope {
+ public:
+  ProfileScope(Profiler* profiler, const char* name)
+      : profiler_(profiler->enabled() ? profiler : nullptr),
+        name_(name),
+        start_(profiler_ ? SDL_GetPerformanceCounter() : 0) {}
+  ~ProfileScope() {
+    if (profiler_) {
+      const double milliseconds =
+          1000.0 * static_cast<double>(SDL_GetPerformanceCounter() - start_) /
+          static_cast<double>(SDL_GetPerformanceFrequency());
+      profiler_->AddSample(name_, milliseconds);
+    }
+  }
+
+ private:
+  Profiler* profiler_;
+  const char* name_;
+  Uint64 start_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_PROFILER_H_
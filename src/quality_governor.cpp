@@ -0,0 +1,91 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "quality_governor.h"
+
+#include <algorithm>
+#include "fplbase/utilities.h"
+
+namespace fpl {
+namespace zooshi {
+
+QualityGovernor::QualityGovernor()
+    : config_(nullptr),
+      level_(0),
+      next_frame_(0),
+      num_slow_frames_(0),
+      frames_since_change_(0) {}
+
+void QualityGovernor::Initialize(const QualityGovernorConfig* config) {
+  config_ = config;
+  slow_frames_.assign(
+      config ? static_cast<size_t>(std::max(config->window_frames(), 1)) : 1,
+      false);
+  SetLevel(0);
+}
+
+const QualityLevel* QualityGovernor::current_level() const {
+  if (!config_ || !config_->levels() || config_->levels()->size() == 0) {
+    return nullptr;
+  }
+  return config_->levels()->Get(level_);
+}
+
+void QualityGovernor::SetLevel(int level) {
+  level_ = level;
+  std::fill(slow_frames_.begin(), slow_frames_.end(), false);
+  next_frame_ = 0;
+  num_slow_frames_ = 0;
+  frames_since_change_ = 0;
+}
+
+bool QualityGovernor::AdvanceFrame(int frame_time, bool missed_vsync) {
+  if (!config_ || !config_->enabled() || !config_->levels()) return false;
+  const int num_levels = static_cast<int>(config_->levels()->size());
+  if (num_levels < 2) return false;
+
+  const bool slow = missed_vsync || frame_time > config_->target_frame_time();
+  num_slow_frames_ += (slow ? 1 : 0) - (slow_frames_[next_frame_] ? 1 : 0);
+  slow_frames_[next_frame_] = slow;
+  next_frame_ = (next_frame_ + 1) % slow_frames_.size();
+  frames_since_change_++;
+  if (frames_since_change_ < static_cast<int>(slow_frames_.size())) {
+    return false;
+  }
+
+  const float slow_fraction =
+      static_cast<float>(num_slow_frames_) / slow_frames_.size();
+  int level = level_;
+  if (slow_fraction > config_->lower_threshold() &&
+      frames_since_change_ >= config_->lower_delay_frames() &&
+      level_ + 1 < num_levels) {
+    level = level_ + 1;
+  } else if (slow_fraction < config_->raise_threshold() &&
+             frames_since_change_ >= config_->raise_delay_frames() &&
+             level_ > 0) {
+    level = level_ - 1;
+  }
+  if (level == level_) return false;
+
+  fplbase::LogInfo(
+      "Quality governor: %s quality from level %d to %d, %.0f%% of the last "
+      "%d frames were slow.",
+      level > level_ ? "lowering" : "raising", level_, level,
+      100.0f * slow_fraction, static_cast<int>(slow_frames_.size()));
+  SetLevel(level);
+  return true;
+}
+
+}  // zooshi
+}  // fpl
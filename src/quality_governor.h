@@ -0,0 +1,63 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_QUALITY_GOVERNOR_H_
+#define ZOOSHI_QUALITY_GOVERNOR_H_
+
+#include <vector>
+#include "config_generated.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Picks one of the quality levels in the config, based on how many of the
+// recent frames were slow. The quality is lowered as soon as too many frames
+// are slow, and only raised again after a long run of fast frames.
+class QualityGovernor {
+ public:
+  QualityGovernor();
+
+  // `config` may be null, in which case the quality never changes.
+  void Initialize(const QualityGovernorConfig* config);
+
+  // Record how long the last frame took, and whether it missed a vsync.
+  // Returns true if the quality level changed.
+  bool AdvanceFrame(int frame_time, bool missed_vsync);
+
+  // Index of the current level in the config's `levels`.
+  int level() const { return level_; }
+
+  // The current quality level, or null if there are no levels to pick from.
+  const QualityLevel* current_level() const;
+
+ private:
+  void SetLevel(int level);
+
+  const QualityGovernorConfig* config_;
+  int level_;
+
+  // Ring buffer with one entry per recent frame, true if it was slow.
+  std::vector<bool> slow_frames_;
+  size_t next_frame_;
+  int num_slow_frames_;
+
+  // Frames since the level last changed. The window only counts as full once
+  // this reaches its size, so each level is judged on its own frames.
+  int frames_since_change_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_QUALITY_GOVERNOR_H_
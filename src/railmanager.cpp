@@ -14,6 +14,7 @@
 
 #include "railmanager.h"
 
+#include <string.h>
 #include <map>
 #include "components/rail_node.h"
 #include "corgi_component_library/transform.h"
@@ -123,7 +124,7 @@ Rail *RailManager::GetRailFromComponents(const char *rail_name,
     return nullptr;  // invalid rail name
   }
 
-  std::vector<vec3_packed> positions;
+  std::vector<vec3_packed> &positions = positions_;
   positions.resize(rail_entities.size() + 1);
   const RailNodeData *first_data =
       rail_component->GetComponentData(rail_entities.begin()->second);
@@ -144,14 +145,46 @@ Rail *RailManager::GetRailFromComponents(const char *rail_name,
   positions[i] =
       transform_component->WorldPosition(rail_entities.begin()->second);
 
-  // Cache this until we request the rail from these components again.
-  rail_map[rail_name] = std::unique_ptr<Rail>(new Rail());
-  rail_map[rail_name]->InitializeFromPositions(positions, kSplineGranularity,
-                                               reliable_distance, total_time);
-  return rail_map[rail_name].get();
+  // Fitting the spline is the expensive part, so reuse the last fit if the
+  // nodes haven't changed since.
+  ComponentRail &component_rail = component_rails_[rail_name];
+  if (component_rail.rail && component_rail.total_time == total_time &&
+      component_rail.reliable_distance == reliable_distance &&
+      component_rail.positions.size() == positions.size() &&
+      memcmp(&component_rail.positions[0], &positions[0],
+             positions.size() * sizeof(positions[0])) == 0) {
+    num_spline_fits_avoided_++;
+    return component_rail.rail.get();
+  }
+
+  // Fit into the existing Rail, if there is one, so that pointers to its
+  // splines stay valid.
+  Rail rail;
+  rail.InitializeFromPositions(positions, kSplineGranularity,
+                               reliable_distance, total_time);
+  if (component_rail.rail) {
+    *component_rail.rail = rail;
+  } else {
+    component_rail.rail.reset(new Rail(rail));
+  }
+  component_rail.positions = positions;
+  component_rail.total_time = total_time;
+  component_rail.reliable_distance = reliable_distance;
+  // Generations are drawn from the fit count so that they are never reused,
+  // even after Clear().
+  component_rail.generation = ++num_spline_fits_;
+  return component_rail.rail.get();
 }
 
-void RailManager::Clear() { rail_map.clear(); }
+int RailManager::RailGeneration(const std::string &rail_name) const {
+  auto iter = component_rails_.find(rail_name);
+  return iter == component_rails_.end() ? 0 : iter->second.generation;
+}
+
+void RailManager::Clear() {
+  rail_map.clear();
+  component_rails_.clear();
+}
 
 }  // zooshi
 }  // fpl
@@ -16,7 +16,9 @@
 #define RAILMANAGER_H
 
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "components_generated.h"
 #include "corgi/entity_manager.h"
 #include "mathfu/glsl_mappings.h"
@@ -43,6 +45,14 @@ class Rail {
   /// calling Positions() above instead.
   mathfu::vec3 PositionCalculatedSlowly(float time) const;
 
+  /// Return the rail position and direction of travel at each of the `count`
+  /// times in `times`, which must be sorted in increasing order. Each spline
+  /// segment is only set up once, however many of the times fall within it,
+  /// so this is much faster than evaluating the times one by one.
+  void SortedPositionsAndDirections(const float* times, size_t count,
+                                    mathfu::vec3_packed* positions,
+                                    mathfu::vec3_packed* directions) const;
+
   /// Length of the rail.
   float EndTime() const { return splines_[0].EndX(); }
 
@@ -62,19 +72,52 @@ class Rail {
 // Class for handling loading and storing of rails.
 class RailManager {
  public:
+  RailManager() : num_spline_fits_(0), num_spline_fits_avoided_(0) {}
+
   // Returns the data for the rail specified in the supplied filename.
   // If that data has already been loaded, it just returns the data directly.
   // Otherwise, it loads the data and caches it.
   Rail* GetRail(RailId rail_file);
 
   // Returns the data for a rail specified by RailNodeComponent entities.
+  // The spline is only re-fit when the nodes with `rail_name` have changed
+  // since the last call. The returned Rail stays at the same address when it
+  // is re-fit, so splines handed out earlier remain valid.
   Rail* GetRailFromComponents(const char* rail_name,
                               corgi::EntityManager* entity_manager);
 
+  // Number of times GetRailFromComponents() had to fit a spline, and the
+  // number of times it returned a cached spline instead.
+  int num_spline_fits() const { return num_spline_fits_; }
+  int num_spline_fits_avoided() const { return num_spline_fits_avoided_; }
+
+  // Changes each time the rail named `rail_name` is re-fit, and is 0 if it has
+  // never been fit. Holders of the rail compare it against the value they last
+  // saw to detect a rebuild.
+  int RailGeneration(const std::string& rail_name) const;
+
   void Clear();
 
  private:
+  // A rail fit to RailNodeComponent entities, along with the node data it
+  // was fit to.
+  struct ComponentRail {
+    ComponentRail()
+        : total_time(0.0f), reliable_distance(0.0f), generation(0) {}
+    std::unique_ptr<Rail> rail;
+    std::vector<mathfu::vec3_packed> positions;
+    float total_time;
+    float reliable_distance;
+    int generation;
+  };
+
   std::unordered_map<RailId, std::unique_ptr<Rail>> rail_map;
+  std::unordered_map<std::string, ComponentRail> component_rails_;
+  int num_spline_fits_;
+  int num_spline_fits_avoided_;
+
+  // Scratch buffer used to gather node positions.
+  std::vector<mathfu::vec3_packed> positions_;
 };
 
 }  // zooshi
@@ -0,0 +1,61 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_RENDER_STATE_GROUPS_H_
+#define ZOOSHI_RENDER_STATE_GROUPS_H_
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace fpl {
+namespace zooshi {
+
+// The draws [begin, end) all share a shader and a mesh.
+struct RenderStateGroup {
+  size_t begin;
+  size_t end;
+};
+
+// Sort `draws` so that the ones with the same shader and mesh are next to each
+// other, and output each such run to `groups`, in order. `Draw` needs
+// `shader` and `mesh` pointer members. Drawing the groups one after the other
+// sets each shader up once, and keeps the draws of each mesh together.
+template <typename Draw>
+void GroupByRenderState(std::vector<Draw>* draws,
+                        std::vector<RenderStateGroup>* groups) {
+  std::sort(draws->begin(), draws->end(), [](const Draw& a, const Draw& b) {
+    if (a.shader != b.shader) {
+      return std::less<decltype(a.shader)>()(a.shader, b.shader);
+    }
+    return std::less<decltype(a.mesh)>()(a.mesh, b.mesh);
+  });
+
+  groups->clear();
+  for (size_t i = 0; i < draws->size(); ++i) {
+    const Draw& draw = (*draws)[i];
+    if (i == 0 || draw.shader != (*draws)[i - 1].shader ||
+        draw.mesh != (*draws)[i - 1].mesh) {
+      RenderStateGroup group;
+      group.begin = i;
+      groups->push_back(group);
+    }
+    groups->back().end = i + 1;
+  }
+}
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_RENDER_STATE_GROUPS_H_
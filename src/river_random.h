@@ -0,0 +1,55 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_RIVER_RANDOM_H_
+#define ZOOSHI_RIVER_RANDOM_H_
+
+#include <stdint.h>
+
+namespace fpl {
+namespace zooshi {
+
+// Counter-based random number generator. Each value is a hash of the seed and
+// a counter, so any value can be computed on its own, on any thread, without
+// touching the global random number generator. The river uses it to place
+// its bank vertices, so a river looks the same however its segments are
+// split between threads.
+class RiverRandom {
+ public:
+  explicit RiverRandom(unsigned int seed) : seed_hash_(Hash(seed)) {}
+
+  // Returns the value for `counter`, in the range [0, 1).
+  float Get(uint32_t counter) const {
+    static const float kOneOver2To24 = 1.0f / 16777216.0f;
+    return static_cast<float>(Hash(counter + seed_hash_) >> 8) * kOneOver2To24;
+  }
+
+ private:
+  // Integer hash with good avalanche behavior ("lowbias32").
+  static uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+  }
+
+  uint32_t seed_hash_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_RIVER_RANDOM_H_
@@ -0,0 +1,139 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+using mathfu::vec2;
+using mathfu::vec3;
+
+namespace fpl {
+namespace zooshi {
+
+int SpatialGrid::CellCoord(float f) const {
+  return static_cast<int>(std::floor(f / cell_size_));
+}
+
+uint64_t SpatialGrid::CellKey(int x, int y) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) |
+         static_cast<uint64_t>(static_cast<uint32_t>(y));
+}
+
+size_t SpatialGrid::Bucket(uint64_t cell) const {
+  // Fibonacci hashing spreads neighboring cells over the buckets.
+  const uint64_t hash = cell * 0x9e3779b97f4a7c15ULL;
+  return static_cast<size_t>(hash >> 32) & bucket_mask_;
+}
+
+void SpatialGrid::Add(const vec3& position, const vec3& velocity,
+                      float sweep_time, int index) {
+  const vec2 start = position.xy();
+  const vec2 sweep = velocity.xy() * sweep_time;
+
+  // Walk the trajectory in pieces no longer than a cell, and add the cells
+  // overlapped by each piece's bounding box. A long diagonal trajectory would
+  // otherwise cover a huge number of cells with a single bounding box.
+  // Consecutive pieces share an end point, so the cells that the previous
+  // piece already added are skipped.
+  const int num_steps =
+      std::max(1, static_cast<int>(std::ceil(sweep.Length() / cell_size_)));
+  const float step_percent = 1.0f / static_cast<float>(num_steps);
+  vec2 step_start = start;
+  int prev_x_begin = 1, prev_x_end = 0, prev_y_begin = 1, prev_y_end = 0;
+  for (int step = 1; step <= num_steps; ++step) {
+    const vec2 step_end = start + sweep * (step * step_percent);
+    const vec2 step_min = vec2::Min(step_start, step_end);
+    const vec2 step_max = vec2::Max(step_start, step_end);
+    const int x_begin = CellCoord(step_min.x());
+    const int x_end = CellCoord(step_max.x());
+    const int y_begin = CellCoord(step_min.y());
+    const int y_end = CellCoord(step_max.y());
+    for (int x = x_begin; x <= x_end; ++x) {
+      for (int y = y_begin; y <= y_end; ++y) {
+        if (prev_x_begin <= x && x <= prev_x_end && prev_y_begin <= y &&
+            y <= prev_y_end) {
+          continue;
+        }
+        Entry entry;
+        entry.cell = CellKey(x, y);
+        entry.index = index;
+        entries_.push_back(entry);
+      }
+    }
+    prev_x_begin = x_begin;
+    prev_x_end = x_end;
+    prev_y_begin = y_begin;
+    prev_y_end = y_end;
+    step_start = step_end;
+  }
+}
+
+void SpatialGrid::Finalize() {
+  // About one pair per bucket.
+  size_t num_buckets = 1;
+  while (num_buckets < entries_.size()) num_buckets *= 2;
+
+  // Count the pairs in each bucket, turn the counts into start offsets, and
+  // then place each pair after the ones before it in its bucket.
+  bucket_mask_ = num_buckets - 1;
+  bucket_starts_.assign(num_buckets + 1, 0);
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    bucket_starts_[Bucket(it->cell) + 1]++;
+  }
+  for (size_t b = 1; b <= num_buckets; ++b) {
+    bucket_starts_[b] += bucket_starts_[b - 1];
+  }
+  buckets_.resize(entries_.size());
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    buckets_[bucket_starts_[Bucket(it->cell)]++] = *it;
+  }
+  // Placing the pairs advanced each start to the next bucket's start.
+  for (size_t b = num_buckets; b > 0; --b) {
+    bucket_starts_[b] = bucket_starts_[b - 1];
+  }
+  bucket_starts_[0] = 0;
+}
+
+void SpatialGrid::Query(const vec3& position, float radius,
+                        std::vector<int>* indices) const {
+  indices->clear();
+  if (buckets_.empty()) return;
+
+  const int x_begin = CellCoord(position.x() - radius);
+  const int x_end = CellCoord(position.x() + radius);
+  const int y_begin = CellCoord(position.y() - radius);
+  const int y_end = CellCoord(position.y() + radius);
+  for (int x = x_begin; x <= x_end; ++x) {
+    for (int y = y_begin; y <= y_end; ++y) {
+      // Other cells can share the bucket.
+      const uint64_t cell = CellKey(x, y);
+      const size_t bucket = Bucket(cell);
+      const size_t end = bucket_starts_[bucket + 1];
+      for (size_t i = bucket_starts_[bucket]; i < end; ++i) {
+        if (buckets_[i].cell == cell) indices->push_back(buckets_[i].index);
+      }
+    }
+  }
+
+  // A trajectory that crosses several of the queried cells, or that was added
+  // to a cell more than once, is reported once.
+  std::sort(indices->begin(), indices->end());
+  indices->erase(std::unique(indices->begin(), indices->end()),
+                 indices->end());
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,97 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_SPATIAL_GRID_H_
+#define ZOOSHI_SPATIAL_GRID_H_
+
+#include <stdint.h>
+#include <vector>
+#include "mathfu/constants.h"
+#include "mathfu/glsl_mappings.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Uniform grid over the XY plane that indexes moving or static items, such as
+// projectiles or scenery.
+//
+// Each item is added to every cell that its horizontal trajectory passes
+// through over the next `sweep_time` seconds. A query then only has to look at
+// the handful of cells around a point to find every item that could come
+// within a given radius of it during that time.
+//
+// The grid is stored as an array of (cell, index) pairs, bucketed by a hash
+// of the cell with a counting sort. Rebuilding it every frame takes time
+// linear in the number of pairs, and doesn't allocate once the arrays have
+// grown to their steady-state sizes.
+class SpatialGrid {
+ public:
+  explicit SpatialGrid(float cell_size)
+      : cell_size_(cell_size), bucket_mask_(0) {}
+
+  // Remove all items from the grid.
+  void Clear() {
+    entries_.clear();
+    buckets_.clear();
+    bucket_starts_.clear();
+  }
+
+  // Add the item `index` to all the cells touched by its trajectory,
+  // `position` + `velocity` * t, for t in [0, `sweep_time`]. Height is ignored.
+  void Add(const mathfu::vec3& position, const mathfu::vec3& velocity,
+           float sweep_time, int index);
+
+  // Add the static item `index` to the cell that holds `position`.
+  void Add(const mathfu::vec3& position, int index) {
+    Add(position, mathfu::kZeros3f, 0.0f, index);
+  }
+
+  // Bucket the grid. Must be called after the last Add() and before Query().
+  void Finalize();
+
+  // Output the indices of all items whose trajectory comes within `radius` of
+  // `position`, plus some others that are nearby. The indices are unique and
+  // sorted, so callers see items in the same order in which they were added.
+  void Query(const mathfu::vec3& position, float radius,
+             std::vector<int>* indices) const;
+
+  // Number of (cell, item) pairs currently held.
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    uint64_t cell;
+    int index;
+  };
+
+  int CellCoord(float f) const;
+  static uint64_t CellKey(int x, int y);
+  size_t Bucket(uint64_t cell) const;
+
+  float cell_size_;
+
+  // The pairs in the order they were added, and then grouped by bucket.
+  std::vector<Entry> entries_;
+  std::vector<Entry> buckets_;
+
+  // The pairs in bucket `b` are buckets_[bucket_starts_[b], bucket_starts_[b +
+  // 1]). The number of buckets is a power of two, `bucket_mask_` + 1.
+  std::vector<size_t> bucket_starts_;
+  size_t bucket_mask_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_SPATIAL_GRID_H_
@@ -120,12 +120,15 @@ void GameMenuState::Initialize(
 }
 
 void GameMenuState::AdvanceFrame(int delta_time, int* next_state) {
-  world_->entity_manager.UpdateComponents(delta_time);
+  world_->UpdateComponents(delta_time);
   UpdateMainCamera(&main_camera_, world_);
 
+  // The keys only change between frames, so only look at them on the first
+  // tick of a frame.
   bool back_button =
-      input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
-      input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down();
+      !world_->catch_up_tick &&
+      (input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
+       input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down());
   if (back_button) {
     if (menu_state_ == kMenuStateOptions) {
       // Save data when you leave the audio page.
@@ -169,6 +172,8 @@ void GameMenuState::AdvanceFrame(int delta_time, int* next_state) {
 }
 
 void GameMenuState::RenderPrep(fplbase::Renderer* renderer) {
+  // Follow the player's interpolated transform.
+  UpdateMainCamera(&main_camera_, world_);
   world_->world_renderer->RenderPrep(main_camera_, *renderer, world_);
 }
 
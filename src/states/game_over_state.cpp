@@ -64,7 +64,7 @@ void GameOverState::Initialize(fplbase::InputSystem* input_system, World* world,
 }
 
 void GameOverState::AdvanceFrame(int delta_time, int* next_state) {
-  world_->entity_manager.UpdateComponents(delta_time);
+  world_->UpdateComponents(delta_time);
   UpdateMainCamera(&main_camera_, world_);
 
   // Return to the title screen after any key is hit.
@@ -72,15 +72,20 @@ void GameOverState::AdvanceFrame(int delta_time, int* next_state) {
       static_cast<corgi::WorldTime>(8000.0f);
   const bool event_over =
       world_->patron_component.event_time() > kMinTimeInEndState;
+  // The buttons only change between frames, so only look at them on the first
+  // tick of a frame.
+  const bool first_tick = !world_->catch_up_tick;
   const bool pointer_button_pressed =
-      input_system_->GetPointerButton(0).went_down();
+      first_tick && input_system_->GetPointerButton(0).went_down();
   const bool exit_button_pressed =
-      input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
-      input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down();
+      first_tick &&
+      (input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
+       input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down());
   auto player = world_->player_component.begin()->entity;
   auto player_data =
       world_->entity_manager.GetComponentData<PlayerData>(player);
   const bool fire_button_pressed =
+      first_tick &&
       player_data->input_controller()->Button(kFireProjectile).Value() &&
       player_data->input_controller()->Button(kFireProjectile).HasChanged();
   if (event_over &&
@@ -95,6 +100,8 @@ void GameOverState::AdvanceFrame(int delta_time, int* next_state) {
 }
 
 void GameOverState::RenderPrep(fplbase::Renderer* renderer) {
+  // Follow the player's interpolated transform.
+  UpdateMainCamera(&main_camera_, world_);
   world_->world_renderer->RenderPrep(main_camera_, *renderer, world_);
 }
 
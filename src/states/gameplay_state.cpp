@@ -76,12 +76,22 @@ static void UpdateMusic(corgi::EntityManager* entity_manager,
 
 void GameplayState::AdvanceFrame(int delta_time, int* next_state) {
   // Update the world.
-  world_->entity_manager.UpdateComponents(delta_time);
+  world_->UpdateComponents(delta_time);
   UpdateMainCamera(&main_camera_, world_);
   UpdateMusic(&world_->entity_manager, &previous_lap_, &percent_, delta_time,
               &music_channel_lap_1_, &music_channel_lap_2_,
               &music_channel_lap_3_);
 
+  // The state machine for the world may request a state change.
+  *next_state = requested_state_;
+
+  // The keyboard state only changes between frames, so only look at it on
+  // the first tick of a frame.
+  if (world_->catch_up_tick) {
+    fader_->AdvanceFrame(delta_time);
+    return;
+  }
+
   if (input_system_->GetButton(fplbase::FPLK_F9).went_down()) {
     world_->draw_debug_physics = !world_->draw_debug_physics;
   }
@@ -89,9 +99,6 @@ void GameplayState::AdvanceFrame(int delta_time, int* next_state) {
     world_->skip_rendermesh_rendering = !world_->skip_rendermesh_rendering;
   }
 
-  // The state machine for the world may request a state change.
-  *next_state = requested_state_;
-
   // Switch into scene lab if the keyboard requests.
   // Switch back to scene lab if we're single stepping.
   if (scene_lab_ && (input_system_->GetButton(fplbase::FPLK_F10).went_down() ||
@@ -114,6 +121,8 @@ void GameplayState::AdvanceFrame(int delta_time, int* next_state) {
 }
 
 void GameplayState::RenderPrep(fplbase::Renderer* renderer) {
+  // Follow the player's interpolated transform.
+  UpdateMainCamera(&main_camera_, world_);
   world_->world_renderer->RenderPrep(main_camera_, *renderer, world_);
 }
 
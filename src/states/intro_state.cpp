@@ -64,7 +64,7 @@ void IntroState::SetBoxVisibility(bool visibility) {
 
 void IntroState::AdvanceFrame(int delta_time, int* next_state) {
   // Update components so that the player can throw sushi.
-  world_->entity_manager.UpdateComponents(delta_time);
+  world_->UpdateComponents(delta_time);
   // Update camera so that the player can look around.
   UpdateMainCamera(&main_camera_, world_);
 
@@ -92,9 +92,11 @@ void IntroState::AdvanceFrame(int delta_time, int* next_state) {
     fade_timer_ -= delta_time;
   }
 
-  // Go back to menu.
-  if (input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
-      input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down()) {
+  // Go back to menu. The keys only change between frames, so only look at
+  // them on the first tick of a frame.
+  if (!world_->catch_up_tick &&
+      (input_system_->GetButton(fplbase::FPLK_ESCAPE).went_down() ||
+       input_system_->GetButton(fplbase::FPLK_AC_BACK).went_down())) {
     *next_state = kGameStateGameMenu;
   }
 
@@ -106,6 +108,8 @@ void IntroState::AdvanceFrame(int delta_time, int* next_state) {
 }
 
 void IntroState::RenderPrep(fplbase::Renderer* renderer) {
+  // Follow the player's interpolated transform.
+  UpdateMainCamera(&main_camera_, world_);
   world_->world_renderer->RenderPrep(main_camera_, *renderer, world_);
 }
 
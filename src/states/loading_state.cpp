@@ -36,6 +36,7 @@
 #include "pindrop/pindrop.h"
 #include "states/states.h"
 #include "states/states_common.h"
+#include "trace.h"
 #include "world.h"
 
 #define ZOOSHI_WAIT_ON_LOADING_SCREEN 0
@@ -103,8 +104,11 @@ void LoadingState::AdvanceFrame(int delta_time, int* next_state) {
 void LoadingState::Render(fplbase::Renderer* renderer) {
   // Ensure assets are instantiated after they've been loaded.
   // This must be called from the render thread.
-  loading_complete_ =
-      asset_manager_->TryFinalize() && audio_engine_->TryFinalize();
+  {
+    TraceScope scope("FinalizeAssets");
+    loading_complete_ =
+        asset_manager_->TryFinalize() && audio_engine_->TryFinalize();
+  }
 
   // Get a handle to the loading material.
   const char* loading_material_name =
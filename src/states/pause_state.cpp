@@ -57,6 +57,13 @@ void PauseState::AdvanceFrame(int /*delta_time*/, int* next_state) {
 
   *next_state = next_state_;
 
+  // The keys only change between frames, so only look at them on the first
+  // tick of a frame.
+  if (world_->catch_up_tick) {
+    next_state_ = kGameStatePause;
+    return;
+  }
+
   // Unpause
   if (input_system_->GetButton(fplbase::FPLK_p).went_down()) {
     *next_state = kGameStateGameplay;
@@ -120,6 +127,8 @@ GameState PauseState::PauseMenu(fplbase::AssetManager& assetman,
 }
 
 void PauseState::RenderPrep(fplbase::Renderer* renderer) {
+  // Follow the player's interpolated transform.
+  UpdateMainCamera(&main_camera_, world_);
   world_->world_renderer->RenderPrep(main_camera_, *renderer, world_);
 }
 
@@ -45,6 +45,9 @@ void SceneLabState::Initialize(fplbase::Renderer* renderer,
 }
 
 void SceneLabState::AdvanceFrame(corgi::WorldTime delta_time, int* next_state){
+  // Scene Lab is driven by the mouse and keyboard, which only change between
+  // frames, so it skips the catch up ticks.
+  if (world_->catch_up_tick) return;
   scene_lab_->AdvanceFrame(delta_time);
   if (input_system_->GetButton(fplbase::FPLK_F11).went_down()) {
     scene_lab_->SaveScene();
@@ -93,10 +96,14 @@ void SceneLabState::HandleUI(fplbase::Renderer* renderer) {
 }
 
 void SceneLabState::OnEnter(int /*previous_state*/) {
+  world_->sorted_mesh_component.set_enabled(false);
   scene_lab_->Activate();
 }
 
-void SceneLabState::OnExit(int /*next_state*/) { scene_lab_->Deactivate(); }
+void SceneLabState::OnExit(int /*next_state*/) {
+  scene_lab_->Deactivate();
+  world_->sorted_mesh_component.set_enabled(true);
+}
 
 }  // zooshi
 }  // fpl
@@ -0,0 +1,266 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "SDL_atomic.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+#include "fplbase/systrace.h"
+#include "fplbase/utilities.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Number of events each thread keeps. Older events are overwritten.
+static const int kTraceEventsPerThread = 1 << 16;
+
+struct TraceEvent {
+  const char* name;
+  // Chrome trace_event phase: 'X' for a complete span, 'b' and 'e' for the
+  // start and end of an async span, 'C' for a counter.
+  char phase;
+  // The cookie of an async span, or the value of a counter.
+  int value;
+  Uint64 start;
+  Uint64 duration;
+};
+
+struct TraceThreadBuffer {
+  TraceThreadBuffer()
+      : thread_id(SDL_ThreadID()), events(kTraceEventsPerThread) {
+    SDL_AtomicSet(&count, 0);
+  }
+
+  struct OpenSpan {
+    const char* name;
+    Uint64 start;
+  };
+
+  SDL_threadID thread_id;
+
+  // Ring buffer of the most recent events. Only the owning thread writes to
+  // it, and an event only becomes visible to readers once `count` has been
+  // incremented past it.
+  std::vector<TraceEvent> events;
+  SDL_atomic_t count;
+
+  // Spans that have begun but not ended yet, innermost last.
+  std::vector<OpenSpan> open_spans;
+};
+
+// A range of frames being captured, and the buffers of every thread that has
+// traced something since.
+struct TraceCapture {
+  TraceCapture() : mutex(SDL_CreateMutex()), tls(SDL_TLSCreate()) {
+    SDL_AtomicSet(&capturing, 0);
+    SDL_AtomicSet(&saved, 0);
+  }
+  ~TraceCapture() { SDL_DestroyMutex(mutex); }
+
+  int first_frame;
+  int end_frame;
+  int frame;
+  std::string filename;
+  Uint64 start_time;
+  SDL_atomic_t capturing;
+  // Set once the capture has been written out. Nothing is traced after that.
+  SDL_atomic_t saved;
+
+  // Guards `buffers`.
+  SDL_mutex* mutex;
+  std::vector<std::unique_ptr<TraceThreadBuffer>> buffers;
+
+  // Thread local storage slot that holds each thread's buffer.
+  SDL_TLSID tls;
+};
+
+// Only set once, before any thread starts tracing, so it can be read without
+// synchronization.
+static std::unique_ptr<TraceCapture> global_trace_capture;
+
+static inline Uint64 TraceTime() { return SDL_GetPerformanceCounter(); }
+
+static TraceThreadBuffer* CurrentThreadBuffer(TraceCapture* capture) {
+  TraceThreadBuffer* buffer =
+      static_cast<TraceThreadBuffer*>(SDL_TLSGet(capture->tls));
+  if (!buffer) {
+    buffer = new TraceThreadBuffer();
+    SDL_LockMutex(capture->mutex);
+    capture->buffers.push_back(std::unique_ptr<TraceThreadBuffer>(buffer));
+    SDL_UnlockMutex(capture->mutex);
+    SDL_TLSSet(capture->tls, buffer, nullptr);
+  }
+  return buffer;
+}
+
+static void RecordEvent(TraceThreadBuffer* buffer, const char* name,
+                        char phase, int value, Uint64 start, Uint64 duration) {
+  const int count = SDL_AtomicGet(&buffer->count);
+  TraceEvent& event = buffer->events[count % kTraceEventsPerThread];
+  event.name = name;
+  event.phase = phase;
+  event.value = value;
+  event.start = start;
+  event.duration = duration;
+  SDL_AtomicSet(&buffer->count, count + 1);
+}
+
+static void RecordEvent(const char* name, char phase, int value) {
+  TraceCapture* capture = global_trace_capture.get();
+  if (!capture || !SDL_AtomicGet(&capture->capturing)) return;
+  RecordEvent(CurrentThreadBuffer(capture), name, phase, value, TraceTime(),
+              0);
+}
+
+static double TraceMicroseconds(Uint64 ticks) {
+  return static_cast<double>(ticks) * 1000000.0 /
+         static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+static void SaveTrace(TraceCapture* capture) {
+  FILE* file = fopen(capture->filename.c_str(), "w");
+  if (!file) {
+    fplbase::LogError("Couldn't write trace to %s",
+                      capture->filename.c_str());
+    return;
+  }
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  const char* separator = "\n";
+  SDL_LockMutex(capture->mutex);
+  for (auto it = capture->buffers.begin(); it != capture->buffers.end();
+       ++it) {
+    TraceThreadBuffer* buffer = it->get();
+    const unsigned long thread_id =
+        static_cast<unsigned long>(buffer->thread_id);
+    // Once the buffer has wrapped, its owner may still be overwriting the
+    // oldest event, so that one is skipped.
+    const int count = SDL_AtomicGet(&buffer->count);
+    const int first = std::max(count - kTraceEventsPerThread + 1, 0);
+    for (int i = first; i < count; ++i) {
+      const TraceEvent& event = buffer->events[i % kTraceEventsPerThread];
+      const double timestamp =
+          TraceMicroseconds(event.start - capture->start_time);
+      fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, "
+              "\"pid\": 1, \"tid\": %lu", separator, event.name, event.phase,
+              timestamp, thread_id);
+      switch (event.phase) {
+        case 'X':
+          fprintf(file, ", \"dur\": %.3f",
+                  TraceMicroseconds(event.duration));
+          break;
+        case 'b':
+        case 'e':
+          fprintf(file, ", \"cat\": \"async\", \"id\": %d", event.value);
+          break;
+        case 'C':
+          fprintf(file, ", \"args\": {\"value\": %d}", event.value);
+          break;
+      }
+      fprintf(file, "}");
+      separator = ",\n";
+    }
+  }
+  SDL_UnlockMutex(capture->mutex);
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  fplbase::LogInfo("Saved trace of frames %d to %d to %s.",
+                   capture->first_frame, capture->end_frame - 1,
+                   capture->filename.c_str());
+}
+
+void TraceCaptureFrames(int first_frame, int num_frames,
+                        const std::string& filename) {
+  TraceCapture* capture = new TraceCapture();
+  capture->first_frame = std::max(first_frame, 0);
+  capture->end_frame = capture->first_frame + std::max(num_frames, 1);
+  capture->frame = -1;
+  capture->filename = filename;
+  capture->start_time = TraceTime();
+  global_trace_capture.reset(capture);
+}
+
+void TraceFrame() {
+  TraceCapture* capture = global_trace_capture.get();
+  if (!capture || SDL_AtomicGet(&capture->saved)) return;
+  capture->frame++;
+  if (capture->frame == capture->first_frame) {
+    SDL_AtomicSet(&capture->capturing, 1);
+  } else if (capture->frame == capture->end_frame) {
+    TraceFlush();
+  }
+}
+
+void TraceFlush() {
+  TraceCapture* capture = global_trace_capture.get();
+  if (!capture || !SDL_AtomicGet(&capture->capturing)) return;
+  SDL_AtomicSet(&capture->capturing, 0);
+  SDL_AtomicSet(&capture->saved, 1);
+  SaveTrace(capture);
+}
+
+bool TraceCapturing() {
+  TraceCapture* capture = global_trace_capture.get();
+  return capture && SDL_AtomicGet(&capture->capturing);
+}
+
+// Spans are tracked from when a capture is set up until it is saved, even
+// before the captured frames, so that a span that is open when the capture
+// starts is still recorded with its full length.
+void TraceBegin(const char* name) {
+  SystraceBegin(name);
+  TraceCapture* capture = global_trace_capture.get();
+  if (!capture || SDL_AtomicGet(&capture->saved)) return;
+  TraceThreadBuffer::OpenSpan span;
+  span.name = name;
+  span.start = TraceTime();
+  CurrentThreadBuffer(capture)->open_spans.push_back(span);
+}
+
+void TraceEnd() {
+  SystraceEnd();
+  TraceCapture* capture = global_trace_capture.get();
+  if (!capture || SDL_AtomicGet(&capture->saved)) return;
+  TraceThreadBuffer* buffer = CurrentThreadBuffer(capture);
+  if (buffer->open_spans.empty()) return;
+  const TraceThreadBuffer::OpenSpan span = buffer->open_spans.back();
+  buffer->open_spans.pop_back();
+  if (SDL_AtomicGet(&capture->capturing)) {
+    RecordEvent(buffer, span.name, 'X', 0, span.start,
+                TraceTime() - span.start);
+  }
+}
+
+void TraceAsyncBegin(const char* name, int cookie) {
+  SystraceAsyncBegin(name, cookie);
+  RecordEvent(name, 'b', cookie);
+}
+
+void TraceAsyncEnd(const char* name, int cookie) {
+  SystraceAsyncEnd(name, cookie);
+  RecordEvent(name, 'e', cookie);
+}
+
+void TraceCounter(const char* name, int value) {
+  SystraceCounter(name, value);
+  RecordEvent(name, 'C', value);
+}
+
+}  // zooshi
+}  // fpl
@@ -0,0 +1,67 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_TRACE_H_
+#define ZOOSHI_TRACE_H_
+
+#include <string>
+
+namespace fpl {
+namespace zooshi {
+
+// Timeline tracing. These functions forward to fplbase's Systrace functions,
+// which only produce output on Android. In addition, a range of frames can be
+// captured on any platform and saved as Chrome trace_event JSON, which can be
+// opened in chrome://tracing.
+//
+// Every thread records into a ring buffer of its own, so recording never
+// takes a lock. Event names must stay valid until the trace is saved, so they
+// are usually string literals.
+
+// Capture the frames [`first_frame`, `first_frame` + `num_frames`), and save
+// them to `filename` once the last one has finished. Must be called before
+// any other thread starts tracing.
+void TraceCaptureFrames(int first_frame, int num_frames,
+                        const std::string& filename);
+
+// Mark the start of the next frame. Called by the render thread.
+void TraceFrame();
+
+// Save the capture now, if frames are still being captured. Called on exit.
+void TraceFlush();
+
+// True while frames are being captured.
+bool TraceCapturing();
+
+// Nested spans of time on the calling thread.
+void TraceBegin(const char* name);
+void TraceEnd();
+
+// Spans of time that may start and end on different threads.
+void TraceAsyncBegin(const char* name, int cookie);
+void TraceAsyncEnd(const char* name, int cookie);
+
+void TraceCounter(const char* name, int value);
+
+// Traces the span of time between its construction and destruction.
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name) { TraceBegin(name); }
+  ~TraceScope() { TraceEnd(); }
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_TRACE_H_
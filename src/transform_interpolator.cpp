@@ -0,0 +1,146 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transform_interpolator.h"
+
+namespace fpl {
+namespace zooshi {
+
+using corgi::component_library::TransformComponent;
+using corgi::component_library::TransformData;
+using mathfu::mat3;
+using mathfu::mat4;
+using mathfu::quat;
+using mathfu::vec3;
+
+// Entities that move further than this in one tick jumped, rather than moved,
+// so they're drawn where they ended up.
+static const float kMaxBlendDistance = 2.0f;
+
+static void Decompose(const mat4& transform, vec3* position,
+                      quat* orientation, vec3* scale) {
+  *position = transform.TranslationVector3D();
+  mat3 rotation = mat4::ToRotationMatrix(transform);
+  for (int column = 0; column < 3; ++column) {
+    const vec3 axis(rotation(0, column), rotation(1, column),
+                    rotation(2, column));
+    const float length = axis.Length();
+    (*scale)[column] = length;
+    if (length == 0.0f) continue;
+    for (int row = 0; row < 3; ++row) {
+      rotation(row, column) /= length;
+    }
+  }
+  *orientation = quat::FromMatrix(rotation);
+}
+
+static mat4 BlendTransforms(const mat4& from, const mat4& to, float alpha) {
+  vec3 from_position, from_scale, to_position, to_scale;
+  quat from_orientation, to_orientation;
+  Decompose(from, &from_position, &from_orientation, &from_scale);
+  Decompose(to, &to_position, &to_orientation, &to_scale);
+  return mat4::FromTranslationVector(
+             vec3::Lerp(from_position, to_position, alpha)) *
+         quat::Slerp(from_orientation, to_orientation, alpha).ToMatrix4() *
+         mat4::FromScaleVector(vec3::Lerp(from_scale, to_scale, alpha));
+}
+
+static bool SameTransform(const mat4& a, const mat4& b) {
+  for (int i = 0; i < 16; ++i) {
+    if (a[i] != b[i]) return false;
+  }
+  return true;
+}
+
+void TransformInterpolator::Restore(TransformComponent* transforms) {
+  for (auto blend = blends_.begin(); blend != blends_.end(); ++blend) {
+    if (!blend->entity.IsValid()) continue;
+    TransformData* transform_data = transforms->GetComponentData(blend->entity);
+    if (transform_data != nullptr) {
+      transform_data->world_transform = blend->simulated;
+    }
+  }
+}
+
+void TransformInterpolator::Capture(TransformComponent* transforms) {
+  previous_.clear();
+  for (auto iter = transforms->begin(); iter != transforms->end(); ++iter) {
+    Entry entry;
+    entry.entity = iter->entity;
+    entry.transform = iter->data.world_transform;
+    previous_.push_back(entry);
+  }
+  blends_.clear();
+  blends_found_ = false;
+}
+
+void TransformInterpolator::FindBlends(TransformComponent* transforms) {
+  blends_.clear();
+  blends_found_ = true;
+
+  // The transform component's order only changes when entities are added or
+  // removed. Entities that didn't exist at the capture aren't blended.
+  size_t i = 0;
+  for (auto iter = transforms->begin(); iter != transforms->end(); ++iter) {
+    if (i + 1 < previous_.size() && previous_[i].entity != iter->entity &&
+        previous_[i + 1].entity == iter->entity) {
+      ++i;
+    }
+    if (i >= previous_.size() || previous_[i].entity != iter->entity) continue;
+
+    const mat4& previous = previous_[i++].transform;
+    const mat4& simulated = iter->data.world_transform;
+    if (SameTransform(previous, simulated)) continue;
+    const float distance =
+        (simulated.TranslationVector3D() - previous.TranslationVector3D())
+            .Length();
+    if (distance > kMaxBlendDistance) continue;
+
+    Blend blend;
+    blend.entity = iter->entity;
+    blend.previous = previous;
+    blends_.push_back(blend);
+  }
+}
+
+void TransformInterpolator::Interpolate(float alpha,
+                                        TransformComponent* transforms) {
+  if (!blends_found_) FindBlends(transforms);
+  for (auto blend = blends_.begin(); blend != blends_.end(); ++blend) {
+    TransformData* transform_data =
+        blend->entity.IsValid() ? transforms->GetComponentData(blend->entity)
+                                : nullptr;
+    if (transform_data == nullptr) {
+      // Nothing to restore once the entity is gone.
+      blend->entity = corgi::EntityRef();
+      continue;
+    }
+    // The world transform may have changed since the last tick, in an update
+    // that didn't advance time.
+    blend->simulated = transform_data->world_transform;
+    if (alpha < 1.0f) {
+      transform_data->world_transform =
+          BlendTransforms(blend->previous, blend->simulated, alpha);
+    }
+  }
+}
+
+void TransformInterpolator::Clear() {
+  previous_.clear();
+  blends_.clear();
+  blends_found_ = false;
+}
+
+}  // zooshi
+}  // fpl
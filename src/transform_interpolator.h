@@ -0,0 +1,79 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZOOSHI_TRANSFORM_INTERPOLATOR_H_
+#define ZOOSHI_TRANSFORM_INTERPOLATOR_H_
+
+#include <vector>
+#include "corgi/entity_manager.h"
+#include "corgi_component_library/transform.h"
+#include "mathfu/glsl_mappings.h"
+
+namespace fpl {
+namespace zooshi {
+
+// Smooths out rendering when frames don't line up with the fixed simulation
+// ticks. The world transforms of the entities that moved in the last tick are
+// rendered part way between that tick and the one before, by how far real
+// time has got into the next tick.
+class TransformInterpolator {
+ public:
+  TransformInterpolator() : blends_found_(false) {}
+
+  // Put back the simulated world transforms of the entities that were
+  // blended, before simulating more ticks.
+  void Restore(corgi::component_library::TransformComponent* transforms);
+
+  // Remember the world transforms, before simulating the last tick of a frame.
+  void Capture(corgi::component_library::TransformComponent* transforms);
+
+  // Blend the world transforms that changed since Capture() from the captured
+  // ones towards the simulated ones by `alpha`, in [0, 1]. Positions are
+  // interpolated and orientations slerped. Entities that jumped further than
+  // a raft could move in a tick, such as when the raft is reset, aren't
+  // blended.
+  void Interpolate(float alpha,
+                   corgi::component_library::TransformComponent* transforms);
+
+  // Forget the captured transforms, so nothing is blended or restored.
+  void Clear();
+
+ private:
+  struct Entry {
+    corgi::EntityRef entity;
+    mathfu::mat4 transform;
+  };
+
+  struct Blend {
+    corgi::EntityRef entity;
+    mathfu::mat4 previous;
+    mathfu::mat4 simulated;
+  };
+
+  // Find the entities whose transforms changed since Capture().
+  void FindBlends(corgi::component_library::TransformComponent* transforms);
+
+  // All the transforms before the last tick.
+  std::vector<Entry> previous_;
+
+  // The entities that moved in the last tick. Only these are blended and
+  // restored, so frames without a new tick don't look at the others.
+  std::vector<Blend> blends_;
+  bool blends_found_;
+};
+
+}  // zooshi
+}  // fpl
+
+#endif  // ZOOSHI_TRANSFORM_INTERPOLATOR_H_
@@ -19,12 +19,14 @@
 #include "flatbuffers/flatbuffers.h"
 #include "fplbase/input.h"
 #include "fplbase/render_target.h"
+#include "fplbase/utilities.h"
 #include "input_config_generated.h"
 #include "mathfu/constants.h"
 #include "mathfu/glsl_mappings.h"
 #include "motive/init.h"
 #include "motive/math/angle.h"
 #include "rail_def_generated.h"
+#include "trace.h"
 #include "world.h"
 
 #ifdef ANDROID_HMD
@@ -46,6 +48,18 @@ namespace zooshi {
 static const char kEntityLibraryFile[] = "entity_prototypes.zooentity";
 static const char kComponentDefBinarySchema[] =
     "flatbufferschemas/components.bfbs";
+// Light used to shade the meshes. Both of the components that draw meshes
+// must use the same one.
+static const vec3 kLightPosition(-10, -20, 20);
+
+template <typename T>
+void World::RegisterComponent(T* component, ComponentDataUnion def_type,
+                              const char* def_name, const char* name) {
+  entity_factory->SetComponentType(entity_manager.RegisterComponent(component),
+                                   def_type, def_name);
+  ProfiledComponent profiled_component = {name, component};
+  profiled_components_.push_back(profiled_component);
+}
 
 void World::Initialize(const Config& config_,
                        fplbase::InputSystem* input_system,
@@ -75,81 +89,68 @@ void World::Initialize(const Config& config_,
                                        graph_factory, input_system, renderer);
   services_component.Initialize(config, asset_manager, input_system,
                                 audio_engine, font_manager, &rail_manager,
-                                entity_factory.get(), this, scene_lab);
-
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&common_services_component),
-      ComponentDataUnion_ServicesDef, "CommonServicesDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&services_component),
-      ComponentDataUnion_ServicesDef, "ServicesDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&graph_component),
-      ComponentDataUnion_GraphDef, "GraphDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&attributes_component),
-      ComponentDataUnion_AttributesDef, "AttributesDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&rail_denizen_component),
-      ComponentDataUnion_RailDenizenDef, "RailDenizenDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&simple_movement_component),
-      ComponentDataUnion_SimpleMovementDef, "SimpleMovementDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&lap_dependent_component),
-      ComponentDataUnion_LapDependentDef, "LapDependentDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&player_component),
-      ComponentDataUnion_PlayerDef, "PlayerDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&player_projectile_component),
-      ComponentDataUnion_PlayerProjectileDef, "PlayerProjectileDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&render_mesh_component),
-      ComponentDataUnion_RenderMeshDef, "RenderMeshDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&physics_component),
-      ComponentDataUnion_PhysicsDef, "PhysicsDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&patron_component),
-      ComponentDataUnion_PatronDef, "PatronDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&time_limit_component),
-      ComponentDataUnion_TimeLimitDef, "TimeLimitDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&audio_listener_component),
-      ComponentDataUnion_ListenerDef, "ListenerDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&sound_component),
-      ComponentDataUnion_SoundDef, "SoundDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&digit_component),
-      ComponentDataUnion_DigitDef, "DigitDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&river_component),
-      ComponentDataUnion_RiverDef, "RiverDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&shadow_controller_component),
-      ComponentDataUnion_ShadowControllerDef, "ShadowControllerDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&meta_component),
-      ComponentDataUnion_MetaDef, "MetaDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&edit_options_component),
-      ComponentDataUnion_EditOptionsDef, "EditOptionsDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&scenery_component),
-      ComponentDataUnion_SceneryDef, "SceneryDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&animation_component),
-      ComponentDataUnion_AnimationDef, "AnimationDef");
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&rail_node_component),
-      ComponentDataUnion_RailNodeDef, "RailNodeDef");
+                                entity_factory.get(), &job_system, this,
+                                scene_lab);
+
+  profiled_components_.clear();
+  RegisterComponent(&common_services_component, ComponentDataUnion_ServicesDef,
+                    "CommonServicesDef", "CommonServices");
+  RegisterComponent(&services_component, ComponentDataUnion_ServicesDef,
+                    "ServicesDef", "Services");
+  RegisterComponent(&graph_component, ComponentDataUnion_GraphDef, "GraphDef",
+                    "Graph");
+  RegisterComponent(&attributes_component, ComponentDataUnion_AttributesDef,
+                    "AttributesDef", "Attributes");
+  RegisterComponent(&rail_denizen_component, ComponentDataUnion_RailDenizenDef,
+                    "RailDenizenDef", "RailDenizen");
+  RegisterComponent(&simple_movement_component,
+                    ComponentDataUnion_SimpleMovementDef, "SimpleMovementDef",
+                    "SimpleMovement");
+  RegisterComponent(&lap_dependent_component,
+                    ComponentDataUnion_LapDependentDef, "LapDependentDef",
+                    "LapDependent");
+  RegisterComponent(&player_component, ComponentDataUnion_PlayerDef,
+                    "PlayerDef", "Player");
+  RegisterComponent(&player_projectile_component,
+                    ComponentDataUnion_PlayerProjectileDef,
+                    "PlayerProjectileDef", "PlayerProjectile");
+  RegisterComponent(&render_mesh_component, ComponentDataUnion_RenderMeshDef,
+                    "RenderMeshDef", "RenderMesh");
+  RegisterComponent(&physics_component, ComponentDataUnion_PhysicsDef,
+                    "PhysicsDef", "Physics");
+  RegisterComponent(&patron_component, ComponentDataUnion_PatronDef,
+                    "PatronDef", "Patron");
+  RegisterComponent(&time_limit_component, ComponentDataUnion_TimeLimitDef,
+                    "TimeLimitDef", "TimeLimit");
+  RegisterComponent(&audio_listener_component, ComponentDataUnion_ListenerDef,
+                    "ListenerDef", "AudioListener");
+  RegisterComponent(&sound_component, ComponentDataUnion_SoundDef, "SoundDef",
+                    "Sound");
+  RegisterComponent(&digit_component, ComponentDataUnion_DigitDef, "DigitDef",
+                    "Digit");
+  RegisterComponent(&river_component, ComponentDataUnion_RiverDef, "RiverDef",
+                    "River");
+  RegisterComponent(&shadow_controller_component,
+                    ComponentDataUnion_ShadowControllerDef,
+                    "ShadowControllerDef", "ShadowController");
+  RegisterComponent(&meta_component, ComponentDataUnion_MetaDef, "MetaDef",
+                    "Meta");
+  RegisterComponent(&edit_options_component, ComponentDataUnion_EditOptionsDef,
+                    "EditOptionsDef", "EditOptions");
+  RegisterComponent(&scenery_component, ComponentDataUnion_SceneryDef,
+                    "SceneryDef", "Scenery");
+  RegisterComponent(&animation_component, ComponentDataUnion_AnimationDef,
+                    "AnimationDef", "Animation");
+  RegisterComponent(&rail_node_component, ComponentDataUnion_RailNodeDef,
+                    "RailNodeDef", "RailNode");
+  RegisterComponent(&shadow_caster_component,
+                    ComponentDataUnion_ShadowCasterDef, "ShadowCasterDef",
+                    "ShadowCaster");
+  RegisterComponent(&sorted_mesh_component, ComponentDataUnion_SortedMeshDef,
+                    "SortedMeshDef", "SortedMesh");
   // Make sure you register TransformComponent after any components that use it.
-  entity_factory->SetComponentType(
-      entity_manager.RegisterComponent(&transform_component),
-      ComponentDataUnion_TransformDef, "TransformDef");
+  RegisterComponent(&transform_component, ComponentDataUnion_TransformDef,
+                    "TransformDef", "Transform");
 
   physics_component.set_collision_callback(&PatronComponent::CollisionHandler,
                                            &patron_component);
@@ -161,14 +162,34 @@ void World::Initialize(const Config& config_,
 
   entity_manager.set_entity_factory(entity_factory.get());
 
-  render_mesh_component.set_light_position(vec3(-10, -20, 20));
+  render_mesh_component.set_light_position(kLightPosition);
   render_mesh_component.SetCullDistance(
       config->rendering_config()->cull_distance());
+  sorted_mesh_component.set_light_position(kLightPosition);
+  sorted_mesh_component.SetCullDistance(
+      config->rendering_config()->cull_distance());
 
   cardboard_settings_gear =
       asset_manager->FindMaterial("materials/settings_gear.fplmat");
 }
 
+void World::UpdateComponents(corgi::WorldTime delta_time) {
+  if (!profiler.enabled() && !TraceCapturing()) {
+    entity_manager.UpdateComponents(delta_time);
+    return;
+  }
+  // The same steps as EntityManager::UpdateComponents(), which updates the
+  // components in the order they were registered, then deletes the entities
+  // marked for deletion. It has no hook to time each component on its own.
+  for (auto it = profiled_components_.begin();
+       it != profiled_components_.end(); ++it) {
+    TraceScope trace_scope(it->name);
+    ProfileScope profile_scope(&profiler, it->name);
+    it->component->UpdateAllEntities(delta_time);
+  }
+  entity_manager.DeleteMarkedEntities();
+}
+
 void World::AddController(BasePlayerController* controller) {
   input_controllers.push_back(
       std::unique_ptr<BasePlayerController>(controller));
@@ -212,6 +233,9 @@ void World::SetIsInCardboard(bool in_cardboard) {
 }
 
 void LoadWorldDef(World* world, const WorldDef* world_def) {
+  const int prev_spline_fits = world->rail_manager.num_spline_fits();
+  const int prev_spline_fits_avoided =
+      world->rail_manager.num_spline_fits_avoided();
   for (auto iter = world->entity_manager.begin();
        iter != world->entity_manager.end(); ++iter) {
     world->entity_manager.DeleteEntity(iter.ToReference());
@@ -241,6 +265,11 @@ void LoadWorldDef(World* world, const WorldDef* world_def) {
   world->services_component.set_raft_entity(raft_entity);
 
   world->graph_component.PostLoadFixup();
+
+  fplbase::LogInfo("Loaded world: %d rail spline fits, %d avoided by cache",
+                   world->rail_manager.num_spline_fits() - prev_spline_fits,
+                   world->rail_manager.num_spline_fits_avoided() -
+                       prev_spline_fits_avoided);
 }
 
 }  // zooshi
@@ -18,9 +18,11 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "components/attributes.h"
 #include "components/audio_listener.h"
+#include "components/sorted_mesh.h"
 #include "components/digit.h"
 #include "components/lap_dependent.h"
 #include "components/patron.h"
@@ -31,6 +33,7 @@
 #include "components/river.h"
 #include "components/scenery.h"
 #include "components/services.h"
+#include "components/shadow_caster.h"
 #include "components/shadow_controller.h"
 #include "components/simple_movement.h"
 #include "components/sound.h"
@@ -50,9 +53,12 @@
 #include "inputcontrollers/base_player_controller.h"
 #include "inputcontrollers/gamepad_controller.h"
 #include "inputcontrollers/onscreen_controller.h"
+#include "job_system.h"
+#include "profiler.h"
 #include "railmanager.h"
 #include "scene_lab/edit_options.h"
 #include "scene_lab/scene_lab.h"
+#include "transform_interpolator.h"
 #include "world_renderer.h"
 
 namespace pindrop {
@@ -71,12 +77,18 @@ namespace zooshi {
 class WorldRenderer;
 struct Config;
 
+// Number of recent samples of each profiled section that the percentiles
+// are computed from. About ten seconds of frames.
+static const size_t kProfilerWindowSize = 600;
+
 struct World {
  public:
   World()
       : draw_debug_physics(false),
         skip_rendermesh_rendering(false),
         is_single_stepping(false),
+        catch_up_tick(false),
+        profiler(kProfilerWindowSize),
         is_in_cardboard_(false) {
 #ifdef ANDROID_HMD
     hmd_controller = nullptr;
@@ -101,6 +113,9 @@ struct World {
   // Rail Manager - manages loading and storing of rail definitions
   RailManager rail_manager;
 
+  // Worker threads that components use to update their entities in parallel.
+  JobSystem job_system;
+
   // Components
   corgi::component_library::TransformComponent transform_component;
   corgi::component_library::AnimationComponent animation_component;
@@ -121,6 +136,8 @@ struct World {
   ServicesComponent services_component;
   corgi::component_library::CommonServicesComponent common_services_component;
   ShadowControllerComponent shadow_controller_component;
+  ShadowCasterComponent shadow_caster_component;
+  SortedMeshComponent sorted_mesh_component;
   corgi::component_library::MetaComponent meta_component;
   scene_lab::EditOptionsComponent edit_options_component;
   SimpleMovementComponent simple_movement_component;
@@ -195,7 +212,38 @@ struct World {
 
   bool is_single_stepping;
 
+  // True while running the extra simulation ticks of a frame that has to catch
+  // up with real time. The first tick of the frame already handled the input,
+  // so nothing should act on it again.
+  bool catch_up_tick;
+
+  // Blends the world transforms between simulation ticks for rendering.
+  TransformInterpolator transform_interpolator;
+
+  // Times the update of each component, the render passes and the UI while
+  // it is enabled.
+  Profiler profiler;
+
+  // Update all the components, like entity_manager.UpdateComponents(). While
+  // the profiler is enabled or a trace is captured, each component's update
+  // is measured separately.
+  void UpdateComponents(corgi::WorldTime delta_time);
+
  private:
+  struct ProfiledComponent {
+    const char* name;
+    corgi::ComponentInterface* component;
+  };
+
+  // Register `component` with the entity manager and the entity factory, and
+  // add it to the components whose updates are profiled as `name`.
+  template <typename T>
+  void RegisterComponent(T* component, ComponentDataUnion def_type,
+                         const char* def_name, const char* name);
+
+  // Every component, in the order in which they were registered.
+  std::vector<ProfiledComponent> profiled_components_;
+
   // Determines if the game is in Cardboard mode (for special rendering).
   bool is_in_cardboard_;
 };
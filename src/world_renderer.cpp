@@ -13,7 +13,12 @@
 // limitations under the License.
 
 #include "world_renderer.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
 #include "fplbase/flatbuffer_utils.h"
+#include "trace.h"
 
 using mathfu::vec2i;
 using mathfu::vec2;
@@ -27,15 +32,25 @@ namespace fpl {
 namespace zooshi {
 
 static const int kShadowMapTextureID = 7;
+static const int kDynamicShadowMapTextureID = 6;
 // 45 degrees in radians:
 static const float kShadowMapViewportAngle = 0.7853975f;
 static const vec4 kShadowMapClearColor = vec4(0.99f, 0.99f, 0.99f, 1.0f);
 
 void WorldRenderer::Initialize(World* world) {
-  int shadow_map_resolution =
-      world->config->rendering_config()->shadow_map_resolution();
+  const RenderConfig* rendering_config = world->config->rendering_config();
+  shadow_map_resolution_ = rendering_config->shadow_map_resolution();
+  create_shadow_map_ = rendering_config->create_shadow_map();
+  fog_roll_in_dist_ = rendering_config->fog_roll_in_dist();
+  fog_max_dist_ = rendering_config->fog_max_dist();
+  shadow_map_valid_ = false;
+  shadow_map_cache_hits_ = 0;
+  shadow_map_cache_lookups_ = 0;
+  dynamic_shadow_map_empty_ = false;
   shadow_map_.Initialize(
-      mathfu::vec2i(shadow_map_resolution, shadow_map_resolution));
+      mathfu::vec2i(shadow_map_resolution_, shadow_map_resolution_));
+  dynamic_shadow_map_.Initialize(
+      mathfu::vec2i(shadow_map_resolution_, shadow_map_resolution_));
   depth_shader_ = world->asset_manager->LoadShader("shaders/render_depth");
   textured_shader_ = world->asset_manager->LoadShader("shaders/textured");
   textured_shadowed_shader_ =
@@ -50,47 +65,145 @@ void WorldRenderer::Initialize(World* world) {
       world->asset_manager->LoadShader("shaders/textured_lit_cutout");
   river_shader_ =
       world->asset_manager->LoadShader("shaders/origwater");
+
+  render_pass_names_.clear();
+  for (int pass = 0; pass < corgi::RenderPass_Count; pass++) {
+    char name[32];
+    snprintf(name, sizeof(name), "RenderPass%d", pass);
+    render_pass_names_.push_back(name);
+  }
+}
+
+void WorldRenderer::SetShadowMapResolution(int resolution) {
+  if (resolution == shadow_map_resolution_) return;
+  shadow_map_resolution_ = resolution;
+  shadow_map_.Delete();
+  shadow_map_.Initialize(
+      mathfu::vec2i(shadow_map_resolution_, shadow_map_resolution_));
+  dynamic_shadow_map_.Delete();
+  dynamic_shadow_map_.Initialize(
+      mathfu::vec2i(shadow_map_resolution_, shadow_map_resolution_));
+  shadow_map_valid_ = false;
+  dynamic_shadow_map_empty_ = false;
 }
 
 void WorldRenderer::CreateShadowMap(const corgi::CameraInterface& camera,
                                     fplbase::Renderer& renderer, World* world) {
-  float shadow_map_resolution = static_cast<float>(
-        world->config->rendering_config()->shadow_map_resolution());
-  float shadow_map_zoom = world->config->rendering_config()->shadow_map_zoom();
-  float shadow_map_offset =
-      world->config->rendering_config()->shadow_map_offset();
-  vec3 light_position =
-      LoadVec3(world->config->rendering_config()->light_position());
-  SetLightPosition(light_position);
-  light_camera_.set_viewport_angle(kShadowMapViewportAngle / shadow_map_zoom);
+  ProfileScope scope(&world->profiler, "ShadowMap");
+  const RenderConfig* rendering_config = world->config->rendering_config();
+  float shadow_map_resolution = static_cast<float>(shadow_map_resolution_);
+  float shadow_map_zoom = rendering_config->shadow_map_zoom();
+  float shadow_map_offset = rendering_config->shadow_map_offset();
+  vec3 light_position = LoadVec3(rendering_config->light_position());
+  if ((light_position - light_camera_.position()).LengthSquared() != 0.0f) {
+    SetLightPosition(light_position);
+    shadow_map_valid_ = false;
+  }
+  const float viewport_angle = kShadowMapViewportAngle / shadow_map_zoom;
+  light_camera_.set_viewport_angle(viewport_angle);
   light_camera_.set_viewport_resolution(
       vec2(shadow_map_resolution, shadow_map_resolution));
+
+  // Snap the focus to a grid of shadow map texels, so that shadow edges don't
+  // crawl as the light camera follows the player. The grid is in light space:
+  // centered below the light, with texels sized for the light's fixed height
+  // above the ground, so the grid doesn't change as the focus moves.
   vec3 light_camera_focus =
       camera.position() + camera.facing() * shadow_map_offset;
   light_camera_focus.z() = 0;
-  vec3 light_facing = light_camera_focus - light_camera_.position();
-  light_camera_.set_facing(light_facing.Normalized());
-
-  // Shadow map needs to be cleared to near-white, since that's
-  // the maximum (furthest) depth.
-  shadow_map_.SetAsRenderTarget();
-  renderer.ClearFrameBuffer(kShadowMapClearColor);
-  renderer.SetCulling(fplbase::Renderer::kCullBack);
-
-  depth_shader_->Set(renderer);
-  // Generate the shadow map:
-  // TODO - modify this so that shadowcast is its own render pass
-  for (int pass = 0; pass < corgi::RenderPass_Count; pass++) {
-    world->render_mesh_component.RenderPass(pass, light_camera_,
-                                            renderer, depth_shader_);
+  const float light_height = std::max(light_position.z(), 1.0f);
+  const float texel_size = 2.0f * tan(viewport_angle * 0.5f) * light_height /
+                           shadow_map_resolution;
+  const vec3 light_space_focus = light_camera_focus - light_position;
+  light_camera_focus.x() =
+      light_position.x() +
+      floor(light_space_focus.x() / texel_size + 0.5f) * texel_size;
+  light_camera_focus.y() =
+      light_position.y() +
+      floor(light_space_focus.y() / texel_size + 0.5f) * texel_size;
+
+  // Until the focus moves far enough, keep the light camera where the shadow
+  // map was rendered from, since that's what the shadowed shader samples it
+  // with.
+  const float max_focus_move =
+      rendering_config->shadow_map_cache_texels() * texel_size;
+  if (!shadow_map_valid_ ||
+      (light_camera_focus - shadow_map_focus_).LengthSquared() >
+          max_focus_move * max_focus_move) {
+    vec3 light_facing = light_camera_focus - light_camera_.position();
+    light_camera_.set_facing(light_facing.Normalized());
+    shadow_map_focus_ = light_camera_focus;
+    shadow_map_valid_ = false;
   }
+
+  ShadowCasterComponent& casters = world->shadow_caster_component;
+  const bool static_casters_changed = casters.GatherCasters(light_camera_);
+
+  // Only the static casters decide whether the cached shadow map can be
+  // reused. Moving ones are drawn into the dynamic shadow map below.
+  shadow_map_cache_lookups_++;
+  int num_draw_calls = 0;
+  if (shadow_map_valid_ && !static_casters_changed) {
+    shadow_map_cache_hits_++;
+  } else {
+    // Shadow map needs to be cleared to near-white, since that's
+    // the maximum (furthest) depth.
+    shadow_map_.SetAsRenderTarget();
+    renderer.ClearFrameBuffer(kShadowMapClearColor);
+    renderer.SetCulling(fplbase::Renderer::kCullBack);
+
+    depth_shader_->Set(renderer);
+    // Generate the shadow map from the shadow casters the light can see.
+    casters.RenderStaticPass(light_camera_, renderer, depth_shader_);
+    num_draw_calls += casters.num_static_casters();
+    shadow_map_valid_ = true;
+  }
+
+  // The dynamic shadow map is redrawn every frame, unless it's already empty
+  // and there's nothing to draw in it. The shadowed shader takes the nearest
+  // depth of the two maps.
+  const int num_dynamic_casters = casters.num_dynamic_casters();
+  if (num_dynamic_casters > 0 || !dynamic_shadow_map_empty_) {
+    dynamic_shadow_map_.SetAsRenderTarget();
+    renderer.ClearFrameBuffer(kShadowMapClearColor);
+    renderer.SetCulling(fplbase::Renderer::kCullBack);
+
+    depth_shader_->Set(renderer);
+    casters.RenderDynamicPass(light_camera_, renderer, depth_shader_);
+    num_draw_calls += num_dynamic_casters;
+    dynamic_shadow_map_empty_ = num_dynamic_casters == 0;
+  }
+
+  TraceCounter("ShadowDrawCalls", num_draw_calls);
+  if (TraceCapturing()) {
+    // Every visible render mesh used to be drawn into the shadow map. Only
+    // count them for the trace, as it means visiting every render mesh.
+    int num_meshes = 0;
+    for (auto iter = world->render_mesh_component.begin();
+         iter != world->render_mesh_component.end(); ++iter) {
+      if (iter->data.mesh != nullptr && iter->data.visible) num_meshes++;
+    }
+    TraceCounter("ShadowDrawCallsSaved", num_meshes - num_draw_calls);
+  }
+  TraceCounter("ShadowMapCacheHitRate",
+               static_cast<int>(100.0f * shadow_map_cache_hit_rate()));
 }
 
 void WorldRenderer::RenderPrep(const corgi::CameraInterface& camera,
                                fplbase::Renderer& renderer, World* world) {
-  if (world->config->rendering_config()->create_shadow_map()) {
+  if (create_shadow_map_) {
     CreateShadowMap(camera, renderer, world);
   }
+  world->river_component.CullChunks(camera);
+
+  // Sorted meshes leave the render mesh component's opaque pass, so gather
+  // them first.
+  SortedMeshComponent& sorted_meshes = world->sorted_mesh_component;
+  sorted_meshes.GatherMeshes(camera);
+  TraceCounter("SortedMeshDraws", sorted_meshes.num_drawn());
+  TraceCounter("SortedMeshStateGroups", sorted_meshes.num_state_groups());
+  TraceCounter("SortedMeshCulled", sorted_meshes.num_culled());
+
   world->render_mesh_component.RenderPrep(camera);
 }
 
@@ -121,10 +234,8 @@ void WorldRenderer::DebugShowShadowMap(const corgi::CameraInterface& camera,
 }
 
 void WorldRenderer::SetFogUniforms(fplbase::Shader* shader, World* world) {
-  shader->SetUniform("fog_roll_in_dist",
-                     world->config->rendering_config()->fog_roll_in_dist());
-  shader->SetUniform("fog_max_dist",
-                     world->config->rendering_config()->fog_max_dist());
+  shader->SetUniform("fog_roll_in_dist", fog_roll_in_dist_);
+  shader->SetUniform("fog_max_dist", fog_max_dist_);
   shader->SetUniform(
       "fog_color",
       LoadColorRGBA(world->config->rendering_config()->fog_color()));
@@ -181,10 +292,15 @@ void WorldRenderer::RenderWorld(const corgi::CameraInterface& camera,
   SetFogUniforms(textured_skinned_lit_shader_, world);
 
   shadow_map_.BindAsTexture(kShadowMapTextureID);
+  dynamic_shadow_map_.BindAsTexture(kDynamicShadowMapTextureID);
 
   if (!world->skip_rendermesh_rendering) {
     for (int pass = 0; pass < corgi::RenderPass_Count; pass++) {
+      ProfileScope scope(&world->profiler, render_pass_names_[pass].c_str());
       world->render_mesh_component.RenderPass(pass, camera, renderer);
+      if (pass == corgi::RenderPass_Opaque) {
+        world->sorted_mesh_component.RenderMeshes(camera, renderer);
+      }
     }
   }
 
@@ -15,6 +15,8 @@
 #ifndef ZOOSHI_WORLD_RENDERER_H_
 #define ZOOSHI_WORLD_RENDERER_H_
 
+#include <string>
+#include <vector>
 #include "world.h"
 
 namespace fpl {
@@ -49,6 +51,34 @@ class WorldRenderer {
     light_camera_.set_position(light_pos);
   }
 
+  // Change the resolution of the shadow map. Must be called from the render
+  // thread, as it recreates the shadow map's render target.
+  void SetShadowMapResolution(int resolution);
+  int shadow_map_resolution() const { return shadow_map_resolution_; }
+
+  // Whether a shadow map is created each frame. Starts out as set in the
+  // rendering config.
+  void set_create_shadow_map(bool create) {
+    create_shadow_map_ = create;
+    shadow_map_valid_ = false;
+  }
+  bool create_shadow_map() const { return create_shadow_map_; }
+
+  // Change the distances at which the fog starts and reaches its maximum.
+  // They start out as set in the rendering config.
+  void SetFogDistances(float roll_in_dist, float max_dist) {
+    fog_roll_in_dist_ = roll_in_dist;
+    fog_max_dist_ = max_dist;
+  }
+
+  // Fraction of the frames with a shadow map that reused the last one.
+  float shadow_map_cache_hit_rate() const {
+    return shadow_map_cache_lookups_
+               ? static_cast<float>(shadow_map_cache_hits_) /
+                     shadow_map_cache_lookups_
+               : 0.0f;
+  }
+
  private:
   fplbase::Shader* depth_shader_;
   fplbase::Shader* textured_shader_;
@@ -60,6 +90,26 @@ class WorldRenderer {
   fplbase::Shader* river_shader_;
   Camera light_camera_;
   fplbase::RenderTarget shadow_map_;
+  fplbase::RenderTarget dynamic_shadow_map_;
+
+  // Name of each render pass's profiler section.
+  std::vector<std::string> render_pass_names_;
+
+  // The rendering config's settings, as adjusted at runtime.
+  int shadow_map_resolution_;
+  bool create_shadow_map_;
+  float fog_roll_in_dist_;
+  float fog_max_dist_;
+
+  // The shadow map is kept until the light camera has to move, or the static
+  // casters it sees change. `shadow_map_focus_` is where the light camera
+  // points. The dynamic casters are drawn into `dynamic_shadow_map_` every
+  // frame.
+  bool shadow_map_valid_;
+  bool dynamic_shadow_map_empty_;
+  mathfu::vec3 shadow_map_focus_;
+  int shadow_map_cache_hits_;
+  int shadow_map_cache_lookups_;
 
   // Create the shadowmap for the current worldstate.  Needs to be called
   // before RenderWorld.
@@ -0,0 +1,137 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "job_system.h"
+
+using fpl::zooshi::JobSystem;
+
+namespace {
+
+const int kNumScalingRuns = 5;
+
+// Run a ParallelFor() over `count` elements, and check that every element was
+// visited exactly once, by ranges of at most `chunk_size` elements. Without
+// worker threads, the whole loop is one range.
+void ExpectEachElementOnce(JobSystem* job_system, size_t count,
+                           size_t chunk_size) {
+  std::vector<std::atomic<int>> visits(count);
+  for (auto it = visits.begin(); it != visits.end(); ++it) *it = 0;
+  const size_t max_range = job_system->num_threads() == 0
+                               ? count
+                               : std::max(chunk_size, static_cast<size_t>(1));
+  std::atomic<bool> range_too_large(false);
+  job_system->ParallelFor(
+      count, chunk_size, [&](size_t begin, size_t end) {
+        if (end - begin > max_range) range_too_large = true;
+        for (size_t i = begin; i < end; ++i) visits[i]++;
+      });
+  EXPECT_FALSE(range_too_large) << count << " by " << chunk_size;
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(1, visits[i]) << "element " << i << " of " << count << " by "
+                            << chunk_size;
+  }
+}
+
+class JobSystemTest : public ::testing::TestWithParam<int> {
+ protected:
+  virtual void SetUp() { job_system_.Initialize(GetParam()); }
+  virtual void TearDown() { job_system_.Shutdown(); }
+  JobSystem job_system_;
+};
+
+TEST_P(JobSystemTest, CoversEveryElementOnce) {
+  const size_t kCounts[] = {0, 1, 7, 64, 65, 1000, 4099};
+  const size_t kChunkSizes[] = {0, 1, 3, 64, 5000};
+  for (size_t count : kCounts) {
+    for (size_t chunk_size : kChunkSizes) {
+      ExpectEachElementOnce(&job_system_, count, chunk_size);
+    }
+  }
+}
+
+// Back-to-back loops, as the game runs every frame. A worker that is late to
+// finish one loop must not run, or miss, chunks of the next.
+TEST_P(JobSystemTest, RepeatedLoops) {
+  for (int i = 0; i < 2000; ++i) {
+    ExpectEachElementOnce(&job_system_, 37 + i % 50, 4);
+  }
+}
+
+// A loop that fits in one chunk runs on the calling thread only.
+TEST_P(JobSystemTest, SingleChunkRunsInline) {
+  const std::thread::id caller = std::this_thread::get_id();
+  int calls = 0;
+  bool inline_only = true;
+  job_system_.ParallelFor(10, 10, [&](size_t begin, size_t end) {
+    calls++;
+    inline_only = inline_only && std::this_thread::get_id() == caller &&
+                  begin == 0 && end == 10;
+  });
+  EXPECT_EQ(1, calls);
+  EXPECT_TRUE(inline_only);
+}
+
+// Time a loop of costly elements with no workers and with this many, and
+// print the speedup. Not asserted, as it depends on the machine's cores and
+// load.
+TEST_P(JobSystemTest, Scaling) {
+  const size_t kCount = 4096;
+  const size_t kChunkSize = 64;
+  std::vector<float> results(kCount);
+  auto function = [&results](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      float x = static_cast<float>(i);
+      for (int j = 0; j < 2000; ++j) x = std::sin(x) + 1.0f;
+      results[i] = x;
+    }
+  };
+
+  JobSystem serial;
+  serial.Initialize(0);
+  double serial_ms = 0.0;
+  double parallel_ms = 0.0;
+  for (int run = 0; run < kNumScalingRuns; ++run) {
+    const auto serial_start = std::chrono::steady_clock::now();
+    serial.ParallelFor(kCount, kChunkSize, function);
+    const auto parallel_start = std::chrono::steady_clock::now();
+    job_system_.ParallelFor(kCount, kChunkSize, function);
+    const auto parallel_end = std::chrono::steady_clock::now();
+    serial_ms += std::chrono::duration<double, std::milli>(parallel_start -
+                                                           serial_start)
+                     .count();
+    parallel_ms += std::chrono::duration<double, std::milli>(parallel_end -
+                                                             parallel_start)
+                       .count();
+  }
+  printf("%d worker threads on %u cores: %.2fms, calling thread only: "
+         "%.2fms, speedup %.2fx\n",
+         GetParam(), std::thread::hardware_concurrency(),
+         parallel_ms / kNumScalingRuns,
+         serial_ms / kNumScalingRuns, serial_ms / parallel_ms);
+  RecordProperty("speedup_percent",
+                 static_cast<int>(100.0 * serial_ms / parallel_ms));
+}
+
+INSTANTIATE_TEST_CASE_P(NumThreads, JobSystemTest,
+                        ::testing::Values(0, 1, 3, 7));
+
+}  // namespace
@@ -0,0 +1,101 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <vector>
+#include "gtest/gtest.h"
+#include "render_state_groups.h"
+
+using fpl::zooshi::GroupByRenderState;
+using fpl::zooshi::RenderStateGroup;
+
+namespace {
+
+// Stand-ins for shaders and meshes. Only their addresses matter.
+const int kShaders[2] = {0, 0};
+const int kMeshes[3] = {0, 0, 0};
+
+struct Draw {
+  const int* shader;
+  const int* mesh;
+  int id;
+};
+
+Draw MakeDraw(int shader, int mesh, int id) {
+  Draw draw = {&kShaders[shader], &kMeshes[mesh], id};
+  return draw;
+}
+
+TEST(RenderStateGroupsTest, Empty) {
+  std::vector<Draw> draws;
+  std::vector<RenderStateGroup> groups(1);
+  GroupByRenderState(&draws, &groups);
+  EXPECT_TRUE(draws.empty());
+  EXPECT_TRUE(groups.empty());
+}
+
+TEST(RenderStateGroupsTest, OneGroupPerShaderAndMesh) {
+  std::vector<Draw> draws;
+  draws.push_back(MakeDraw(1, 0, 0));
+  draws.push_back(MakeDraw(0, 2, 1));
+  draws.push_back(MakeDraw(1, 0, 2));
+  draws.push_back(MakeDraw(0, 1, 3));
+  draws.push_back(MakeDraw(0, 2, 4));
+  draws.push_back(MakeDraw(1, 2, 5));
+  draws.push_back(MakeDraw(0, 1, 6));
+  std::vector<RenderStateGroup> groups;
+  GroupByRenderState(&draws, &groups);
+
+  // Every draw is kept.
+  ASSERT_EQ(7u, draws.size());
+  std::vector<int> ids;
+  for (auto it = draws.begin(); it != draws.end(); ++it) ids.push_back(it->id);
+  std::sort(ids.begin(), ids.end());
+  for (int i = 0; i < 7; ++i) EXPECT_EQ(i, ids[i]);
+
+  // (0, 1), (0, 2), (1, 0) and (1, 2), in order and covering every draw.
+  ASSERT_EQ(4u, groups.size());
+  const int kGroupShaders[4] = {0, 0, 1, 1};
+  const int kGroupMeshes[4] = {1, 2, 0, 2};
+  const size_t kGroupSizes[4] = {2, 2, 2, 1};
+  size_t begin = 0;
+  for (size_t g = 0; g < groups.size(); ++g) {
+    EXPECT_EQ(begin, groups[g].begin);
+    EXPECT_EQ(begin + kGroupSizes[g], groups[g].end);
+    for (size_t i = groups[g].begin; i < groups[g].end; ++i) {
+      EXPECT_EQ(&kShaders[kGroupShaders[g]], draws[i].shader);
+      EXPECT_EQ(&kMeshes[kGroupMeshes[g]], draws[i].mesh);
+    }
+    begin = groups[g].end;
+  }
+  EXPECT_EQ(draws.size(), begin);
+}
+
+// Each shader's groups are next to each other, so it only needs to be set up
+// once per shader change.
+TEST(RenderStateGroupsTest, ShadersAreContiguous) {
+  std::vector<Draw> draws;
+  for (int i = 0; i < 30; ++i) draws.push_back(MakeDraw(i % 2, i % 3, i));
+  std::vector<RenderStateGroup> groups;
+  GroupByRenderState(&draws, &groups);
+
+  EXPECT_EQ(6u, groups.size());
+  int shader_changes = 0;
+  for (size_t i = 1; i < draws.size(); ++i) {
+    if (draws[i].shader != draws[i - 1].shader) shader_changes++;
+  }
+  EXPECT_EQ(1, shader_changes);
+}
+
+}  // namespace
@@ -0,0 +1,75 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+#include "river_random.h"
+
+using fpl::zooshi::RiverRandom;
+
+namespace {
+
+const int kNumGoldenValues = 6;
+
+// Every value is a multiple of 2^-24, so it can be compared exactly.
+float Golden(uint32_t numerator) {
+  return static_cast<float>(numerator) / 16777216.0f;
+}
+
+void ExpectGoldenSequence(unsigned int seed,
+                          const uint32_t (&numerators)[kNumGoldenValues]) {
+  const RiverRandom random(seed);
+  for (uint32_t counter = 0; counter < kNumGoldenValues; ++counter) {
+    EXPECT_EQ(Golden(numerators[counter]), random.Get(counter))
+        << "seed " << seed << ", counter " << counter;
+  }
+}
+
+// The river's banks are generated from these values, so changing them changes
+// the look of every level. Only update the golden values on purpose.
+TEST(RiverRandomTest, GoldenSequences) {
+  const uint32_t kSeed0[kNumGoldenValues] = {0,        6850960, 13701921,
+                                             5501417,  14253662, 6047189};
+  const uint32_t kSeed1[kNumGoldenValues] = {5829961,  13785971, 13303779,
+                                             14966870, 9644749,  12589206};
+  const uint32_t kSeed12345[kNumGoldenValues] = {9055663, 2498223,  299826,
+                                                 472246,  13770051, 1664645};
+  ExpectGoldenSequence(0, kSeed0);
+  ExpectGoldenSequence(1, kSeed1);
+  ExpectGoldenSequence(12345, kSeed12345);
+}
+
+// A value only depends on the seed and the counter, not on which values were
+// read before it.
+TEST(RiverRandomTest, ValuesAreIndependentOfOrder) {
+  const RiverRandom forward(42);
+  const RiverRandom backward(42);
+  float values[100];
+  for (uint32_t counter = 0; counter < 100; ++counter) {
+    values[counter] = forward.Get(counter);
+  }
+  for (uint32_t counter = 100; counter-- > 0;) {
+    EXPECT_EQ(values[counter], backward.Get(counter));
+  }
+}
+
+TEST(RiverRandomTest, ValuesAreInUnitRange) {
+  const RiverRandom random(7);
+  for (uint32_t counter = 0; counter < 10000; ++counter) {
+    const float value = random.Get(counter);
+    EXPECT_GE(value, 0.0f);
+    EXPECT_LT(value, 1.0f);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,211 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "gtest/gtest.h"
+#include "mathfu/glsl_mappings.h"
+#include "spatial_grid.h"
+
+using fpl::zooshi::SpatialGrid;
+using mathfu::vec2;
+using mathfu::vec3;
+
+namespace {
+
+// Roughly the game's values: the patron component's grid cells, the longest
+// catch time and the catch distance in the patron prototypes, and the
+// projectile speed in the config. The projectiles and patrons are spread over
+// a stretch of river.
+const float kCellSize = 20.0f;
+const float kSweepTime = 4.0f;
+const float kRadius = 12.0f;
+const float kProjectileSpeed = 40.0f;
+const float kRiverLength = 1000.0f;
+const float kRiverWidth = 100.0f;
+const int kNumPatrons = 50;
+const int kNumBenchmarkFrames = 100;
+
+struct Projectile {
+  vec3 position;
+  vec3 velocity;
+};
+
+// Deterministic values in [min, max), so failures can be reproduced.
+class Random {
+ public:
+  Random() : state_(12345) {}
+  float Range(float min, float max) {
+    state_ = state_ * 1664525u + 1013904223u;
+    return min + (max - min) * static_cast<float>(state_ >> 8) / 16777216.0f;
+  }
+
+ private:
+  unsigned int state_;
+};
+
+std::vector<Projectile> RandomProjectiles(int count, Random* random) {
+  std::vector<Projectile> projectiles(count);
+  for (int i = 0; i < count; ++i) {
+    projectiles[i].position = vec3(random->Range(0.0f, kRiverLength),
+                                   random->Range(0.0f, kRiverWidth),
+                                   random->Range(0.0f, 5.0f));
+    const float angle = random->Range(0.0f, 6.2831853f);
+    projectiles[i].velocity =
+        vec3(std::cos(angle) * kProjectileSpeed,
+             std::sin(angle) * kProjectileSpeed, random->Range(-5.0f, 5.0f));
+  }
+  return projectiles;
+}
+
+std::vector<vec3> RandomPatrons(int count, Random* random) {
+  std::vector<vec3> patrons(count);
+  for (int i = 0; i < count; ++i) {
+    patrons[i] = vec3(random->Range(0.0f, kRiverLength),
+                      random->Range(0.0f, kRiverWidth), 0.0f);
+  }
+  return patrons;
+}
+
+// Horizontal distance from `point` to the trajectory of `projectile` over
+// [0, kSweepTime].
+float TrajectoryDistance(const Projectile& projectile, const vec3& point) {
+  const vec2 start = projectile.position.xy();
+  const vec2 sweep = projectile.velocity.xy() * kSweepTime;
+  const vec2 to_point = point.xy() - start;
+  const float sweep_length_sq = sweep.LengthSquared();
+  const float t =
+      sweep_length_sq > 0.0f
+          ? std::min(std::max(vec2::DotProduct(to_point, sweep) /
+                                  sweep_length_sq,
+                              0.0f),
+                     1.0f)
+          : 0.0f;
+  return (to_point - sweep * t).Length();
+}
+
+// The indices of the projectiles within kRadius of `point`, by checking every
+// one. This is what the grid replaces.
+void BruteForceQuery(const std::vector<Projectile>& projectiles,
+                     const vec3& point, std::vector<int>* indices) {
+  indices->clear();
+  for (size_t i = 0; i < projectiles.size(); ++i) {
+    if (TrajectoryDistance(projectiles[i], point) <= kRadius) {
+      indices->push_back(static_cast<int>(i));
+    }
+  }
+}
+
+// The same search through the grid. Only the projectiles in the cells near
+// `point` get the exact check.
+void GridQuery(const std::vector<Projectile>& projectiles,
+               const SpatialGrid& grid, const vec3& point,
+               std::vector<int>* candidates, std::vector<int>* indices) {
+  grid.Query(point, kRadius, candidates);
+  indices->clear();
+  for (auto it = candidates->begin(); it != candidates->end(); ++it) {
+    if (TrajectoryDistance(projectiles[*it], point) <= kRadius) {
+      indices->push_back(*it);
+    }
+  }
+}
+
+void BuildGrid(const std::vector<Projectile>& projectiles, SpatialGrid* grid) {
+  grid->Clear();
+  for (size_t i = 0; i < projectiles.size(); ++i) {
+    grid->Add(projectiles[i].position, projectiles[i].velocity, kSweepTime,
+              static_cast<int>(i));
+  }
+  grid->Finalize();
+}
+
+class SpatialGridTest : public ::testing::TestWithParam<int> {};
+
+// The grid may return extra projectiles, but never misses one that is in
+// range, and returns each index once, in order.
+TEST_P(SpatialGridTest, QueryFindsEveryProjectileInRange) {
+  Random random;
+  const std::vector<Projectile> projectiles =
+      RandomProjectiles(GetParam(), &random);
+  const std::vector<vec3> patrons = RandomPatrons(kNumPatrons, &random);
+  SpatialGrid grid(kCellSize);
+  BuildGrid(projectiles, &grid);
+
+  std::vector<int> expected;
+  std::vector<int> found;
+  for (auto patron = patrons.begin(); patron != patrons.end(); ++patron) {
+    BruteForceQuery(projectiles, *patron, &expected);
+    grid.Query(*patron, kRadius, &found);
+    EXPECT_TRUE(std::is_sorted(found.begin(), found.end()));
+    EXPECT_TRUE(std::adjacent_find(found.begin(), found.end()) == found.end());
+    EXPECT_TRUE(std::includes(found.begin(), found.end(), expected.begin(),
+                              expected.end()));
+  }
+}
+
+// Time a frame's worth of patron searches both ways. The grid path includes
+// rebuilding the grid, as the patron component does every frame. Both paths
+// find the same projectiles.
+TEST_P(SpatialGridTest, Benchmark) {
+  Random random;
+  const std::vector<Projectile> projectiles =
+      RandomProjectiles(GetParam(), &random);
+  const std::vector<vec3> patrons = RandomPatrons(kNumPatrons, &random);
+  SpatialGrid grid(kCellSize);
+  std::vector<int> candidates;
+  std::vector<int> indices;
+  size_t num_brute_force = 0;
+  size_t num_grid = 0;
+
+  const auto brute_force_start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < kNumBenchmarkFrames; ++frame) {
+    for (auto patron = patrons.begin(); patron != patrons.end(); ++patron) {
+      BruteForceQuery(projectiles, *patron, &indices);
+      num_brute_force += indices.size();
+    }
+  }
+  const auto grid_start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < kNumBenchmarkFrames; ++frame) {
+    BuildGrid(projectiles, &grid);
+    for (auto patron = patrons.begin(); patron != patrons.end(); ++patron) {
+      GridQuery(projectiles, grid, *patron, &candidates, &indices);
+      num_grid += indices.size();
+    }
+  }
+  const auto grid_end = std::chrono::steady_clock::now();
+
+  const double brute_force_us =
+      std::chrono::duration<double, std::micro>(grid_start - brute_force_start)
+          .count() /
+      kNumBenchmarkFrames;
+  const double grid_us =
+      std::chrono::duration<double, std::micro>(grid_end - grid_start)
+          .count() /
+      kNumBenchmarkFrames;
+  printf("%d projectiles, %d patrons: brute force %.1fus/frame, "
+         "grid %.1fus/frame\n",
+         GetParam(), kNumPatrons, brute_force_us, grid_us);
+  RecordProperty("brute_force_us", static_cast<int>(brute_force_us));
+  RecordProperty("grid_us", static_cast<int>(grid_us));
+
+  EXPECT_EQ(num_brute_force, num_grid);
+}
+
+INSTANTIATE_TEST_CASE_P(NumProjectiles, SpatialGridTest,
+                        ::testing::Values(10, 100, 1000));
+
+}  // namespace